@@ -0,0 +1,289 @@
+// File:  availabilityTable.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Current availability for every store or city we check, published in a fixed-layout
+//        shared memory table so other local processes can read it directly.  Each slot is a
+//        seqlock:  the writer makes the sequence odd while it changes the slot, and readers
+//        retry if the sequence was odd or changed while they read.  Readers never block the
+//        writer (or each other).
+
+// Local headers
+#include "availabilityTable.h"
+#include "utilities/uString.h"
+
+// OS headers
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
+// Standard C++ headers
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+const uint32_t AvailabilityTable::layoutMagic(0x54414656);// "VFAT"
+const uint32_t AvailabilityTable::layoutVersion(2);
+#ifdef _WIN32
+const std::string AvailabilityTable::defaultName("Local\\VaccineFinderAvailability");
+#else
+const std::string AvailabilityTable::defaultName("/vaccineFinderAvailability");
+#endif
+const uint32_t AvailabilityTable::defaultSlotCount(1024);
+const unsigned int AvailabilityTable::maxReadAttempts(100);
+
+AvailabilityTable::AvailabilityTable(const std::string& name, const uint32_t& slotCount) : name(name), slotCount(slotCount)
+{
+	mappingSize = sizeof(Header) + sizeof(Slot) * slotCount;
+	if (!Map())
+	{
+		if (inUseByOtherProcess)
+			Cerr << "Shared availability table '" << UString::ToStringType(name) << "' belongs to another running instance; availability won't be published\n";
+		else
+			Cerr << "Failed to create shared availability table '" << UString::ToStringType(name) << "'\n";
+		Unmap();
+		return;
+	}
+
+	// Rebuilt from scratch every run; readers notice createdTime change (or magic go missing while we start up)
+	std::memset(view, 0, mappingSize);
+	header = new (view) Header;
+	slots = reinterpret_cast<Slot*>(static_cast<char*>(view) + sizeof(Header));
+	for (uint32_t i = 0; i < slotCount; ++i)
+		new (slots + i) Slot;
+
+	header->version = layoutVersion;
+	header->slotCount = slotCount;
+	header->slotSize = sizeof(Slot);
+	header->ownerProcess = GetProcessID();
+	header->createdTime = ToUnixTime(std::chrono::system_clock::now());
+	header->usedSlots.store(0, std::memory_order_relaxed);
+
+	// Magic goes last so readers don't trust a half-initialized header
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = layoutMagic;
+}
+
+AvailabilityTable::~AvailabilityTable()
+{
+	Unmap();
+}
+
+#ifdef _WIN32
+bool AvailabilityTable::Map()
+{
+	const auto size(static_cast<unsigned long long>(mappingSize));
+	mappingHandle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+		static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), name.c_str());
+	if (!mappingHandle)
+		return false;
+
+	// The mapping outlives its creator while readers still have it open
+	const bool existed(GetLastError() == ERROR_ALREADY_EXISTS);
+	view = MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, mappingSize);
+	if (!view)
+		return false;
+
+	if (existed && OwnerIsRunning(*static_cast<const Header*>(view)))
+	{
+		inUseByOtherProcess = true;
+		return false;
+	}
+
+	return true;
+}
+
+bool AvailabilityTable::OwnerIsRunning(const Header& existing)
+{
+	if (existing.magic != layoutMagic || existing.ownerProcess == 0)
+		return false;
+
+	HANDLE process(OpenProcess(SYNCHRONIZE, FALSE, existing.ownerProcess));
+	if (!process)
+		return GetLastError() == ERROR_ACCESS_DENIED;// Exists, but isn't ours to look at
+
+	const bool running(WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+	CloseHandle(process);
+	return running;
+}
+
+uint32_t AvailabilityTable::GetProcessID()
+{
+	return static_cast<uint32_t>(GetCurrentProcessId());
+}
+
+void AvailabilityTable::Unmap()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	view = nullptr;
+	mappingHandle = nullptr;
+	header = nullptr;
+	slots = nullptr;
+}
+#else
+bool AvailabilityTable::Map()
+{
+	fileDescriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fileDescriptor < 0 && errno == EEXIST)
+	{
+		const int existing(shm_open(name.c_str(), O_RDONLY, 0));
+		if (existing >= 0)
+		{
+			struct stat info;
+			if (fstat(existing, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(Header))
+			{
+				void* existingView(mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, existing, 0));
+				if (existingView != MAP_FAILED)
+				{
+					inUseByOtherProcess = OwnerIsRunning(*static_cast<const Header*>(existingView));
+					munmap(existingView, sizeof(Header));
+				}
+			}
+
+			close(existing);
+		}
+
+		if (inUseByOtherProcess)
+			return false;
+
+		// Left behind by a finder that didn't exit cleanly
+		shm_unlink(name.c_str());
+		fileDescriptor = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	}
+
+	if (fileDescriptor < 0)
+		return false;
+	ownsName = true;
+
+	if (ftruncate(fileDescriptor, static_cast<off_t>(mappingSize)) != 0)
+		return false;
+
+	view = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		view = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+// The name is removed so the table doesn't outlive us; readers that still have it mapped keep their view
+void AvailabilityTable::Unmap()
+{
+	if (view)
+		munmap(view, mappingSize);
+	if (fileDescriptor >= 0)
+		close(fileDescriptor);
+	if (ownsName)
+		shm_unlink(name.c_str());
+
+	view = nullptr;
+	fileDescriptor = -1;
+	ownsName = false;
+	header = nullptr;
+	slots = nullptr;
+}
+
+bool AvailabilityTable::OwnerIsRunning(const Header& existing)
+{
+	if (existing.magic != layoutMagic || existing.ownerProcess == 0)
+		return false;
+
+	// EPERM means it exists but belongs to someone else
+	return kill(static_cast<pid_t>(existing.ownerProcess), 0) == 0 || errno == EPERM;
+}
+
+uint32_t AvailabilityTable::GetProcessID()
+{
+	return static_cast<uint32_t>(getpid());
+}
+#endif
+
+void AvailabilityTable::Update(const std::string& target, const std::string& location, const bool& available,
+	const std::chrono::system_clock::time_point& checkedTime)
+{
+	if (!header)
+		return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it(slotIndices.find(SlotKeyView{ target, location }));
+	if (it == slotIndices.end())
+	{
+		const uint32_t index(header->usedSlots.load(std::memory_order_relaxed));
+		if (index == slotCount)
+		{
+			if (!fullReported)
+				Cerr << "Shared availability table is full (" << slotCount << " slots); some locations won't be published\n";
+			fullReported = true;
+			return;
+		}
+
+		CopyString(target, slots[index].target, sizeof(slots[index].target));
+		CopyString(location, slots[index].location, sizeof(slots[index].location));
+		header->usedSlots.store(index + 1, std::memory_order_release);
+		it = slotIndices.emplace(SlotKey{ target, location }, index).first;
+	}
+
+	Slot& slot(slots[it->second]);
+	const auto status(static_cast<uint32_t>(available ? Status::Available : Status::Unavailable));
+	const int64_t checked(ToUnixTime(checkedTime));
+
+	const uint64_t sequence(slot.sequence.load(std::memory_order_relaxed));
+	slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	if (slot.status.load(std::memory_order_relaxed) != status)
+	{
+		slot.status.store(status, std::memory_order_relaxed);
+		slot.lastChanged.store(checked, std::memory_order_relaxed);
+	}
+	slot.lastChecked.store(checked, std::memory_order_relaxed);
+
+	slot.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool AvailabilityTable::Read(const Slot& slot, SlotSnapshot& snapshot)
+{
+	for (unsigned int i = 0; i < maxReadAttempts; ++i)
+	{
+		const uint64_t before(slot.sequence.load(std::memory_order_acquire));
+		if (before % 2 == 1)
+			continue;
+
+		snapshot.status = static_cast<Status>(slot.status.load(std::memory_order_relaxed));
+		snapshot.lastChecked = slot.lastChecked.load(std::memory_order_relaxed);
+		snapshot.lastChanged = slot.lastChanged.load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) == before)
+		{
+			snapshot.sequence = before;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void AvailabilityTable::CopyString(const std::string& s, char* destination, const size_t& size)
+{
+	const size_t length(std::min(s.length(), size - 1));
+	std::memcpy(destination, s.data(), length);
+	destination[length] = '\0';
+}
+
+int64_t AvailabilityTable::ToUnixTime(const std::chrono::system_clock::time_point& t)
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count();
+}
@@ -0,0 +1,142 @@
+// File:  availabilityTable.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Current availability for every store or city we check, published in a fixed-layout
+//        shared memory table so other local processes can read it directly.  Each slot is a
+//        seqlock:  the writer makes the sequence odd while it changes the slot, and readers
+//        retry if the sequence was odd or changed while they read.  Readers never block the
+//        writer (or each other).
+
+#ifndef AVAILABILITY_TABLE_H_
+#define AVAILABILITY_TABLE_H_
+
+// Standard C++ headers
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+
+class AvailabilityTable
+{
+public:
+	// Layout shared with readers; bump the version for any change
+	static const uint32_t layoutMagic;
+	static const uint32_t layoutVersion;
+
+	enum class Status : uint32_t
+	{
+		Unknown = 0,
+		Unavailable = 1,
+		Available = 2
+	};
+
+	struct alignas(64) Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;// Capacity
+		uint32_t slotSize;
+		std::atomic<uint32_t> usedSlots;// Slots [0, usedSlots) are filled in; load with acquire before reading them
+		uint32_t ownerProcess;// ID of the finder that writes the table
+		int64_t createdTime;// Unix time [sec]; changes when the finder restarts and rebuilds the table
+	};
+
+	struct alignas(64) Slot
+	{
+		std::atomic<uint64_t> sequence;// Odd while the slot is being written
+		std::atomic<int64_t> lastChecked;// Unix time [sec]
+		std::atomic<int64_t> lastChanged;// Unix time [sec] of the last status change
+		std::atomic<uint32_t> status;
+		uint32_t reserved;
+
+		// Written once, before the slot is counted in usedSlots; null-terminated (truncated if necessary)
+		char target[32];
+		char location[120];
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<int64_t>::is_always_lock_free &&
+		std::atomic<uint32_t>::is_always_lock_free, "Shared memory atomics must be lock-free to work across processes");
+
+	// Memory is laid out as the header followed by slotCount slots
+	explicit AvailabilityTable(const std::string& name, const uint32_t& slotCount = defaultSlotCount);
+	~AvailabilityTable();
+
+	static const std::string defaultName;
+	static const uint32_t defaultSlotCount;
+
+	bool IsOk() const { return header != nullptr; }
+
+	// Thread-safe; adds a slot the first time a target reports a location
+	void Update(const std::string& target, const std::string& location, const bool& available,
+		const std::chrono::system_clock::time_point& checkedTime);
+
+	// For readers:  copies the changing fields of a slot consistently; returns false if the writer kept
+	// interrupting (try again later)
+	struct SlotSnapshot
+	{
+		uint64_t sequence;
+		Status status;
+		int64_t lastChecked;
+		int64_t lastChanged;
+	};
+
+	static bool Read(const Slot& slot, SlotSnapshot& snapshot);
+
+private:
+	const std::string name;
+	const uint32_t slotCount;
+	size_t mappingSize = 0;
+
+	void* mappingHandle = nullptr;// Windows
+	int fileDescriptor = -1;// Elsewhere
+	void* view = nullptr;
+
+	Header* header = nullptr;
+	Slot* slots = nullptr;
+
+	bool Map();
+	void Unmap();
+
+	// A table that exists already is only rebuilt if the finder that wrote it has gone (e.g. it crashed)
+	bool inUseByOtherProcess = false;
+	bool ownsName = false;// Elsewhere; we created it, so we remove it
+	static bool OwnerIsRunning(const Header& existing);
+	static uint32_t GetProcessID();
+
+	// Writers serialize here; readers (in other processes) don't know it exists
+	std::mutex mutex;
+
+	struct SlotKey
+	{
+		std::string target;
+		std::string location;
+	};
+
+	// Lets updates look up the caller's strings without building a SlotKey
+	struct SlotKeyView
+	{
+		const std::string& target;
+		const std::string& location;
+	};
+
+	struct SlotKeyLess
+	{
+		typedef void is_transparent;
+
+		template<typename A, typename B>
+		bool operator()(const A& a, const B& b) const { return std::tie(a.target, a.location) < std::tie(b.target, b.location); }
+	};
+
+	std::map<SlotKey, uint32_t, SlotKeyLess> slotIndices;
+	bool fullReported = false;
+
+	static const unsigned int maxReadAttempts;
+
+	static void CopyString(const std::string& s, char* destination, const size_t& size);
+	static int64_t ToUnixTime(const std::chrono::system_clock::time_point& t);
+};
+
+#endif// AVAILABILITY_TABLE_H_
@@ -0,0 +1,274 @@
+// File:  parserBench.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Runs the response parsers on generated payloads, from tiny to very large, and reports
+//        time per byte, heap allocations per parse and peak heap use during a parse.  Links only
+//        the parsers and cJSON (no wxWidgets, no network).
+
+// Local headers
+#include "cvsTarget.h"
+#include "riteAidTarget.h"
+#include "jeffersonTarget.h"
+
+// Standard C++ headers
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+namespace
+{
+
+// Every heap allocation, whether from operator new (std::string, std::vector) or from cJSON's hooks
+struct HeapCounters
+{
+	unsigned long long allocationCount = 0;
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+};
+
+HeapCounters counters;
+
+// Each block carries its size in front, so frees can be subtracted from the live total
+const size_t headerSize(alignof(std::max_align_t));
+
+void* CountedAllocate(size_t size)
+{
+	void* block(std::malloc(size + headerSize));
+	if (!block)
+		return nullptr;
+
+	*static_cast<size_t*>(block) = size;
+	++counters.allocationCount;
+	counters.liveBytes += size;
+	if (counters.liveBytes > counters.peakBytes)
+		counters.peakBytes = counters.liveBytes;
+	return static_cast<char*>(block) + headerSize;
+}
+
+void CountedFree(void* p)
+{
+	if (!p)
+		return;
+
+	void* block(static_cast<char*>(p) - headerSize);
+	counters.liveBytes -= *static_cast<size_t*>(block);
+	std::free(block);
+}
+
+}// namespace
+
+void* operator new(size_t size)
+{
+	void* p(CountedAllocate(size));
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAllocate(size); }
+void operator delete(void* p) noexcept { CountedFree(p); }
+void operator delete[](void* p) noexcept { CountedFree(p); }
+void operator delete(void* p, size_t) noexcept { CountedFree(p); }
+void operator delete[](void* p, size_t) noexcept { CountedFree(p); }
+
+namespace
+{
+
+const std::chrono::milliseconds minimumRunTime(500);// Per case
+const unsigned int minimumIterations(3);
+
+struct Result
+{
+	std::string parser;
+	std::string payload;
+	size_t bytes;
+	double nsPerByte;
+	unsigned long long allocationsPerParse;
+	size_t peakBytes;// Above what was in use before the parse
+};
+
+// Parse returns false on failure; a failing case is reported rather than timed
+bool Measure(const std::string& parser, const std::string& payload, const std::string& input,
+	const std::function<bool(const std::string&)>& parse, std::vector<Result>& results)
+{
+	// One instrumented parse first (which also warms the caches)
+	const HeapCounters before(counters);
+	counters.peakBytes = counters.liveBytes;
+	if (!parse(input))
+	{
+		std::cerr << parser << " failed to parse the " << payload << " payload\n";
+		return false;
+	}
+
+	Result result;
+	result.parser = parser;
+	result.payload = payload;
+	result.bytes = input.size();
+	result.allocationsPerParse = counters.allocationCount - before.allocationCount;
+	result.peakBytes = counters.peakBytes - before.liveBytes;
+
+	unsigned int iterations(0);
+	const auto start(std::chrono::steady_clock::now());
+	auto elapsed(std::chrono::steady_clock::duration::zero());
+	while (iterations < minimumIterations || elapsed < minimumRunTime)
+	{
+		parse(input);
+		++iterations;
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+
+	result.nsPerByte = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+		/ iterations / static_cast<double>(input.size());
+	results.push_back(result);
+	return true;
+}
+
+// Shaped like the real status response; every seventh city has openings
+std::string GenerateCVSStatus(const unsigned int& cityCount)
+{
+	std::ostringstream ss;
+	ss << R"({"responsePayloadData":{"currentTime":"2026-10-19T08:00:00.000","isBookingCompleted":false,"data":{"PA":[)";
+	for (unsigned int i = 0; i < cityCount; ++i)
+	{
+		if (i > 0)
+			ss << ',';
+		const bool available(i % 7 == 0);
+		ss << R"({"totalAvailable":")" << (available ? 12 : 0) << R"(","city":"CITY )" << i
+			<< R"(","state":"PA","pctAvailable":")" << (available ? "3.00" : "0.00") << R"(%","status":")"
+			<< (available ? "Available" : "Fully Booked") << "\"}";
+	}
+
+	ss << R"(]}},"responseMetaData":{"statusDesc":"Success","conversationId":"Id","refId":"Id","operation":"getVaccineStatus","statusCode":"0000"}})";
+	return ss.str();
+}
+
+// Shaped like the store finder's response, including fields the parser ignores
+std::string GenerateRiteAidStores(const unsigned int& storeCount)
+{
+	std::ostringstream ss;
+	ss << R"({"Data":{"stores":[)";
+	for (unsigned int i = 0; i < storeCount; ++i)
+	{
+		if (i > 0)
+			ss << ',';
+		ss << R"({"storeNumber":)" << 1000 + i << R"(,"address":")" << 100 + i % 900 << R"( Main Street","city":"CITY )" << i % 500
+			<< R"(","state":"PA","zipcode":")" << 19000 + i % 1000 << R"(","timeZone":"EST","fullZipCode":")" << 19000 + i % 1000
+			<< R"(-1234","fullPhone":"(215) 555-0100","locationDescription":"Near the corner","storeType":"CORE","latitude":)"
+			<< 39.0 + (i % 200) * 0.01 << R"(,"longitude":)" << -75.0 - (i % 300) * 0.01 << R"(,"name":"Rite Aid","milesFromCenter":)"
+			<< (i % 50) * 0.5 << R"(,"specialServiceKeys":["PREF-100","PREF-101","PREF-112"],"storeHoursMonday":"9:00am-9:00pm"})";
+	}
+
+	ss << R"(],"globalZipCode":"19103"},"Status":"SUCCESS","ErrCde":null,"ErrMsg":null,"ErrMsgDtl":null})";
+	return ss.str();
+}
+
+std::string GenerateRiteAidStatus()
+{
+	return R"({"Data":{"slots":{"1":false,"2":false}},"Status":"SUCCESS","ErrCde":null,"ErrMsg":null,"ErrMsgDtl":null})";
+}
+
+// Only two "registration full" notices, at the start and the end, so the whole page has to be scanned
+std::string GenerateJeffersonPage(const size_t& approximateBytes)
+{
+	const std::string fullNotice("<p>Registration is currently full at this location.</p>\n");
+	const std::string filler("<div class=\"clinic\"><h3>Vaccination clinic</h3><p>Please check back for more appointments; "
+		"walk-ins are not available at this time.</p></div>\n");
+
+	std::string page("<html><head><title>Vaccination clinics</title></head><body>\n");
+	page += fullNotice;
+	while (page.size() + fullNotice.size() < approximateBytes)
+		page += filler;
+	page += fullNotice;
+	page += "</body></html>\n";
+	return page;
+}
+
+std::string FormatSize(const size_t& bytes)
+{
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	if (bytes >= 1024 * 1024)
+		ss << bytes / (1024.0 * 1024.0) << " MB";
+	else if (bytes >= 1024)
+		ss << bytes / 1024.0 << " kB";
+	else
+		ss << bytes << " B";
+	return ss.str();
+}
+
+void PrintResults(const std::vector<Result>& results)
+{
+	std::cout << std::left << std::setw(32) << "Parser" << std::setw(16) << "Payload" << std::right << std::setw(12) << "Size"
+		<< std::setw(12) << "ns/byte" << std::setw(16) << "Allocs/parse" << std::setw(14) << "Peak heap" << '\n';
+	for (const auto& r : results)
+	{
+		std::cout << std::left << std::setw(32) << r.parser << std::setw(16) << r.payload << std::right << std::setw(12) << FormatSize(r.bytes)
+			<< std::setw(12) << std::fixed << std::setprecision(2) << r.nsPerByte << std::setw(16) << r.allocationsPerParse
+			<< std::setw(14) << FormatSize(r.peakBytes) << '\n';
+	}
+}
+
+}// namespace
+
+int main()
+{
+	cJSON_Hooks hooks;
+	hooks.malloc_fn = CountedAllocate;
+	hooks.free_fn = CountedFree;
+	cJSON_InitHooks(&hooks);
+
+	std::vector<Result> results;
+	bool ok(true);
+
+	const std::vector<std::string> excludeLocations({ "CITY 7", "CITY 14" });
+	for (const auto& count : { 10U, 1000U, 10000U })
+	{
+		ok = Measure("CVSTarget::ParseResponse", std::to_string(count) + " cities", GenerateCVSStatus(count),
+			[&excludeLocations](const std::string& response)
+		{
+			std::vector<std::string> availableCities;
+			std::vector<CVSTarget::LocationAvailability> locations;
+			unsigned int recordCount, skippedCount;
+			return CVSTarget::ParseResponse(response, excludeLocations, availableCities, locations, recordCount, skippedCount);
+		}, results) && ok;
+	}
+
+	for (const auto& count : { 10U, 1000U, 10000U })
+	{
+		ok = Measure("RiteAidTarget::ParseLocations", std::to_string(count) + " stores", GenerateRiteAidStores(count),
+			[](const std::string& response)
+		{
+			std::vector<RiteAidTarget::Location> stores;
+			unsigned int recordCount, skippedCount;
+			return RiteAidTarget::ParseLocations(response, stores, recordCount, skippedCount);
+		}, results) && ok;
+	}
+
+	ok = Measure("RiteAidTarget::ParseStatus", "1 store", GenerateRiteAidStatus(), [](const std::string& response)
+	{
+		bool available;
+		return RiteAidTarget::ParseStatus(response, available);
+	}, results) && ok;
+
+	for (const auto& size : { 10U * 1024U, 1024U * 1024U, 8U * 1024U * 1024U })
+	{
+		ok = Measure("JeffersonTarget (page scan)", FormatSize(size) + " page", GenerateJeffersonPage(size), [](const std::string& response)
+		{
+			// Both notices are found, so the page reads as open; that's still a successful scan
+			JeffersonTarget::DoesNotHaveThreeRegistrationFullStatements(response);
+			return true;
+		}, results) && ok;
+	}
+
+	PrintResults(results);
+	return ok ? 0 : 1;
+}
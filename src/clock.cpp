@@ -0,0 +1,20 @@
+// File:  clock.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Source of the current time for check scheduling, so the same logic can run against
+//        a simulated clock (see Simulator) as well as the real one.
+
+// Local headers
+#include "clock.h"
+
+Clock& Clock::System()
+{
+	static SystemClock clock;
+	return clock;
+}
+
+void SystemClock::WaitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+	const std::chrono::system_clock::time_point& wakeTime, const std::function<bool()>& isStopped)
+{
+	condition.wait_until(lock, wakeTime, isStopped);
+}
@@ -0,0 +1,40 @@
+// File:  clock.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Source of the current time for check scheduling, so the same logic can run against
+//        a simulated clock (see Simulator) as well as the real one.
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+// Standard C++ headers
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class Clock
+{
+public:
+	virtual ~Clock() = default;
+
+	// Thread-safe
+	virtual std::chrono::system_clock::time_point Now() const = 0;
+
+	// Returns once wakeTime has been reached or isStopped() is true (checked whenever condition is notified).  lock
+	// must hold condition's mutex.
+	virtual void WaitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+		const std::chrono::system_clock::time_point& wakeTime, const std::function<bool()>& isStopped) = 0;
+
+	static Clock& System();
+};
+
+class SystemClock : public Clock
+{
+public:
+	std::chrono::system_clock::time_point Now() const override { return std::chrono::system_clock::now(); }
+	void WaitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+		const std::chrono::system_clock::time_point& wakeTime, const std::function<bool()>& isStopped) override;
+};
+
+#endif// CLOCK_H_
@@ -14,7 +14,8 @@
 // Standard C++ headers
 #include <algorithm>
 
-const std::string CVSTarget::cookieFile(".cvsCookies");
+const std::string CVSTarget::defaultURL("https://www.cvs.com/immunizations/covid-19-vaccine");
+const std::string CVSTarget::statusURL("https://www.cvs.com/immunizations/covid-19-vaccine.vaccine-status.PA.json?vaccineinfo");
 
 CVSTarget::~CVSTarget()
 {
@@ -22,28 +23,117 @@ CVSTarget::~CVSTarget()
 		curl_slist_free_all(headerList);
 }
 
-bool CVSTarget::AppointmentsAvailable(std::string& message)
+Task<bool> CVSTarget::AppointmentsAvailable(std::string& message)
 {
-	std::string response;
-	if (!DoCURLGet(url, response, &SetOptions))
+	// Everything depends on the status; don't bother with the session while it's demoted
+	if (GetEndpointAccess(statusURL) == EndpointHealth::Access::Skip)
+		co_return false;
+
+	// The base page is only needed for its cookies
+	if (SessionNeedsRefresh())
 	{
-		SendLogMessage("CVS base get failed");
-		return false;
+		auto page(GetResponseBuffer(url));
+		if (!co_await Get(url, *page, &SetOptions))
+		{
+			SendLogMessage("CVS base get failed");
+			co_return false;
+		}
+		SessionRefreshed();
 	}
 
-	RefererData d;
-	d.referer = UString::ToNarrowString(url);
-	if (!DoCURLGet(_T("https://www.cvs.com/immunizations/covid-19-vaccine.vaccine-status.PA.json?vaccineinfo"), response, &SetOptionsWithReferer, &d))
+	auto response(GetResponseBuffer(statusURL));
+	SharedResponse status;
+	if (!co_await GetShared(statusURL, response, status, &SetOptionsWithReferer, &refererData))
 	{
 		SendLogMessage("CVS get status failed");
-		return false;
+		co_return false;
+	}
+
+	std::vector<std::string> availableCities;
+	if (!ParseStatus(status->body, availableCities))
+		co_return false;
+
+	const auto isAvailable([&availableCities](const std::string& city)
+	{
+		return std::find(availableCities.begin(), availableCities.end(), city) != availableCities.end();
+	});
+
+	reportedCities.erase(std::remove_if(reportedCities.begin(), reportedCities.end(),
+		[&isAvailable](const std::string& city) { return !isAvailable(city); }), reportedCities.end());
+
+	std::vector<std::string> newCities;
+	for (const auto& city : availableCities)
+	{
+		if (std::find(reportedCities.begin(), reportedCities.end(), city) == reportedCities.end())
+			newCities.push_back(city);
+	}
+
+	if (newCities.empty())
+	{
+		if (!availableCities.empty())
+			AlreadyReported();
+		co_return !availableCities.empty();
+	}
+
+	// Status values are sometimes briefly wrong; only report cities that still show availability when asked again
+	if (!co_await Confirm(statusURL, *response, &SetOptionsWithReferer, &refererData))
+	{
+		SendLogMessage("CVS confirm status failed");
+		co_return false;
+	}
+
+	if (!ParseStatus(*response, availableCities))
+		co_return false;
+
+	for (const auto& city : newCities)
+	{
+		if (!isAvailable(city))
+		{
+			SendLogMessage("CVS availability in " + city + " not confirmed");
+			continue;
+		}
+
+		reportedCities.push_back(city);
+		message += city;
+		message += '\n';
 	}
 
-	bool available;
-	if (!ParseResponse(response, available, message))
+	// None of the new cities held up, but ones reported earlier may still be open
+	if (message.empty() && !availableCities.empty())
+		AlreadyReported();
+	co_return !availableCities.empty();
+}
+
+void CVSTarget::SaveState(SnapshotWriter& writer) const
+{
+	FinderTarget::SaveState(writer);
+	writer.Write(static_cast<unsigned int>(reportedCities.size()));
+	for (const auto& city : reportedCities)
+		writer.Write(city);
+}
+
+bool CVSTarget::LoadState(SnapshotReader& reader)
+{
+	unsigned int count;
+	if (!FinderTarget::LoadState(reader) || !reader.Read(count))
 		return false;
 
-	return available;
+	std::vector<std::string> savedCities(count);
+	for (auto& city : savedCities)
+	{
+		if (!reader.Read(city))
+			return false;
+	}
+
+	reportedCities.swap(savedCities);
+	return true;
+}
+
+void CVSTarget::AddStatus(cJSON* status) const
+{
+	AddStringArray(status, "openLocations", openLocations);
+	AddStringArray(status, "reportedCities", reportedCities);
+	AddStringArray(status, "excludeLocations", excludeLocations);
 }
 
 bool CVSTarget::SetOptions(CURL* curl, const ModificationData*)
@@ -55,12 +145,6 @@ bool CVSTarget::SetOptions(CURL* curl, const ModificationData*)
 	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L), _T("Failed to enable location following")))
 		return false;
 
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_COOKIEFILE, cookieFile.c_str()), _T("Failed to load the cookie file")))
-		return false;
-
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_COOKIEJAR, cookieFile.c_str()), _T("Failed to enable saving cookies")))
-		return false;
-
 	return true;
 }
 
@@ -74,101 +158,62 @@ bool CVSTarget::SetOptionsWithReferer(CURL* curl, const ModificationData* data)
 	return true;
 }
 
-bool CVSTarget::ParseResponse(const std::string& response, bool& appointmentsAvailable, std::string& message) const
+bool CVSTarget::ParseStatus(const std::string& response, std::vector<std::string>& availableCities)
 {
-	appointmentsAvailable = false;
-	cJSON* root(cJSON_Parse(response.c_str()));
-	if (!root)
-	{
-		Cerr << "Failed to parse root node\n";
-		return false;
-	}
-
-	cJSON* payload(cJSON_GetObjectItem(root, "responsePayloadData"));
-	if (!payload)
-	{
-		cJSON_free(root);
-		Cerr << "Failed to find payload node\n";
-		return false;
-	}
-
-	bool bookingComplete;
-	if (!ReadJSON(payload, _T("isBookingCompleted"), bookingComplete))
+	std::vector<LocationAvailability> locations;
+	unsigned int recordCount, skippedCount;
+	if (!ParseResponse(response, excludeLocations, availableCities, locations, recordCount, skippedCount))
 	{
-		cJSON_free(root);
-		Cerr << "Failed to read isBookingCompleted\n";
+		RecordParseFailure(statusURL);
 		return false;
 	}
 
-	if (bookingComplete)
-	{
-		cJSON_free(root);
-		return true;
-	}
+	RecordParsed(statusURL, recordCount, skippedCount);
 
-	// To avoid missing potential locations, we'll exclude locations that we know are too far away, but include unknown locations
-	cJSON* data(cJSON_GetObjectItem(payload, "data"));
-	if (!data)
+	openLocations.clear();
+	for (const auto& l : locations)
 	{
-		cJSON_free(root);
-		Cerr << "Failed to find data node\n";
-		return false;
+		PublishAvailability(GetSubscriptionLocation(l.location), l.available);
+		if (l.available)
+			openLocations.push_back(l.location);
+		if (std::find(publishedCities.begin(), publishedCities.end(), l.location) == publishedCities.end())
+			publishedCities.push_back(l.location);
 	}
 
-	cJSON* paLocations(cJSON_GetObjectItem(data, "PA"));
-	if (!paLocations)
+	// Cities are left out entirely once everything is booked
+	for (const auto& city : publishedCities)
 	{
-		cJSON_free(root);
-		Cerr << "Failed to find PA locations array\n";
-		return false;
+		if (std::find_if(locations.begin(), locations.end(), [&city](const LocationAvailability& l) { return l.location == city; }) == locations.end())
+			PublishAvailability(GetSubscriptionLocation(city), false);
 	}
 
-	std::vector<std::string> locations;
-	for (int i = 0; i < cJSON_GetArraySize(paLocations); ++i)
-	{
-		auto location(cJSON_GetArrayItem(paLocations, i));
-		if (!location)
-		{
-			Cerr << "Failed to get location object\n";
-			continue;
-		}
-
-		UString::String status;
-		if (!ReadJSON(location, _T("status"), status))
-		{
-			Cerr << "Failed to get status string\n";
-			continue;
-		}
-
-		if (status == _T("Fully Booked"))
-			continue;
-
-		// If it wasn't fully booked, appointments are available; see if we want to exclude the location
-		UString::String city;
-		if (!ReadJSON(location, _T("city"), city))
-		{
-			Cerr << "Failed to get city string\n";
-			continue;
-		}
-
-		locations.push_back(UString::ToNarrowString(city));
-		if (std::find(excludeLocations.begin(), excludeLocations.end(), city) != excludeLocations.end())
-			continue;
-
-		appointmentsAvailable = true;
-		message += UString::ToNarrowString(city) + '\n';
-	}
-
-	wxTheApp->GetTopWindow()->GetEventHandler()->CallAfter(std::bind(&MainFrame::UpdateCVSLocations, mainFrame, locations));
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	if (!mainFrame)
+		return true;
 
-	cJSON_free(root);
+	MainFrame::UIEvent event;
+	event.type = MainFrame::UIEvent::Type::CVSLocations;
+	event.source = name;
+	event.locations = openLocations;
+	mainFrame->PostUIEvent(std::move(event));
 	return true;
 }
 
-std::vector<UString::String> CVSTarget::MakeListAllCaps(const std::vector<UString::String>& list)
+// Only Pennsylvania is requested (see statusURL)
+SubscriptionEngine::Location CVSTarget::GetSubscriptionLocation(const std::string& city) const
+{
+	SubscriptionEngine::Location location;
+	location.target = name;
+	location.id = city;
+	location.city = city;
+	location.state = "PA";
+	return location;
+}
+
+std::vector<std::string> CVSTarget::MakeListAllCaps(const std::vector<std::string>& list)
 {
-	std::vector<UString::String> ucList(list);
+	std::vector<std::string> ucList(list);
 	for (auto& s : ucList)
-		std::transform(s.begin(), s.end(), s.begin(), ::towupper);// or ::toupper if std::string
+		std::transform(s.begin(), s.end(), s.begin(), [](const unsigned char& c) { return static_cast<char>(::toupper(c)); });
 	return ucList;
 }
@@ -12,35 +12,59 @@
 class CVSTarget : public FinderTarget
 {
 public:
-	CVSTarget(const UString::String& url, MainFrame* mainFrame, const unsigned int& checkPeriod, const std::vector<UString::String>& excludeLocations)
-		: FinderTarget(url, mainFrame, checkPeriod, _T("CVS")), excludeLocations(MakeListAllCaps(excludeLocations)) {}
+	CVSTarget(const std::string& url, MainFrame* mainFrame, FetchEngine* fetchEngine, const unsigned int& checkPeriod, const std::vector<std::string>& excludeLocations)
+		: FinderTarget(url, mainFrame, fetchEngine, checkPeriod, "CVS", ".cvsCookies"), excludeLocations(MakeListAllCaps(excludeLocations)) { refererData.referer = url; }
 	~CVSTarget();
 
+	static const std::string defaultURL;
+
+	struct LocationAvailability
+	{
+		std::string location;
+		bool available;
+	};
+
+	// Doesn't touch the UI, so it can be exercised without a running application
+	// availableCities excludes excludeLocations; locations is every city in the response, with availability.  Locations
+	// missing a field are skipped (and counted) rather than failing the whole response.
+	static bool ParseResponse(const std::string& response, const std::vector<std::string>& excludeLocations,
+		std::vector<std::string>& availableCities, std::vector<LocationAvailability>& locations,
+		unsigned int& recordCount, unsigned int& skippedCount);
+
+	bool IsDemoted() const override { return IsEndpointDemoted(statusURL); }
+
 protected:
-	bool AppointmentsAvailable(std::string& message) override;
+	Task<bool> AppointmentsAvailable(std::string& message) override;
+
+	void SaveState(SnapshotWriter& writer) const override;
+	bool LoadState(SnapshotReader& reader) override;
+	void AddStatus(cJSON* status) const override;
+	UpcomingRequests GetUpcomingRequests(const std::chrono::system_clock::time_point&) const override { return UpcomingRequests{ statusURL, 1, &SetOptionsWithReferer, &refererData }; }
 
 private:
-	static std::vector<UString::String> MakeListAllCaps(const std::vector<UString::String>& list);
-	const std::vector<UString::String> excludeLocations;
+	static std::vector<std::string> MakeListAllCaps(const std::vector<std::string>& list);
+	const std::vector<std::string> excludeLocations;
 
 	struct RefererData : public ModificationData
 	{
 		std::string referer;
 	};
 
+	RefererData refererData;
+	static const std::string statusURL;
+
 	static bool SetOptions(CURL* curl, const ModificationData*);
 	static bool SetOptionsWithReferer(CURL* curl, const ModificationData* data);
 
-	static const std::string cookieFile;
 	struct curl_slist* headerList = nullptr;
 
-	struct LocationAvailability
-	{
-		std::string location;
-		bool available;
-	};
+	// Cities that have been reported and still had availability at the last check; these aren't reported again
+	std::vector<std::string> reportedCities;
+	std::vector<std::string> openLocations;// As of the last status parsed
+	std::vector<std::string> publishedCities;// Every city that has been in a status response
 
-	bool ParseResponse(const std::string& response, bool& appointmentsAvailable, std::string& message) const;
+	bool ParseStatus(const std::string& response, std::vector<std::string>& availableCities);
+	SubscriptionEngine::Location GetSubscriptionLocation(const std::string& city) const;
 };
 
 #endif// CVS_TARGET_H_
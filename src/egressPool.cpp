@@ -0,0 +1,219 @@
+// File:  egressPool.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Set of routes (proxies or local interfaces) that requests can leave through, so polling
+//        isn't throttled as if it all came from one address.  Each request goes out the route
+//        with the best recent success rate and latency; routes that get rate-limited are rested.
+
+// Local headers
+#include "egressPool.h"
+#include "utilities/uString.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+
+const size_t EgressPool::noEgress(std::numeric_limits<size_t>::max());
+const double EgressPool::successSmoothing(0.1);
+const double EgressPool::latencySmoothing(0.2);
+const double EgressPool::referenceLatency(250.0);
+const double EgressPool::minimumWeight(0.02);
+const std::chrono::seconds EgressPool::baseCoolDown(30);
+const std::chrono::seconds EgressPool::maxCoolDown(600);
+
+EgressPool::EgressPool(const std::vector<std::string>& entries)
+{
+	for (const auto& entry : entries)
+	{
+		if (entry.empty())
+			continue;
+
+		Egress egress;
+		if (Parse(entry, egress))
+			egresses.push_back(egress);
+		else
+			Cerr << "Ignoring invalid egress '" << entry.c_str() << "'\n";
+	}
+
+	if (egresses.empty())
+		egresses.push_back(Egress());
+	currentWeights.resize(egresses.size(), 0.0);
+}
+
+bool EgressPool::Parse(const std::string& entry, Egress& egress)
+{
+	if (entry == "direct")
+	{
+		egress.type = Egress::Type::Direct;
+		return true;
+	}
+
+	const auto separator(entry.find('='));
+	if (separator == std::string::npos || separator + 1 == entry.size())
+		return false;
+
+	const std::string type(entry.substr(0, separator));
+	egress.address = entry.substr(separator + 1);
+	if (type == "proxy")
+		egress.type = Egress::Type::Proxy;
+	else if (type == "interface")
+		egress.type = Egress::Type::Interface;
+	else
+		return false;
+
+	return true;
+}
+
+// Favors routes that succeed and respond quickly, but never starves one completely so it can recover
+double EgressPool::GetWeight(const Egress& egress)
+{
+	return std::max(egress.successRate * referenceLatency / (referenceLatency + egress.latency), minimumWeight);
+}
+
+size_t EgressPool::Select(const size_t& avoid)
+{
+	if (egresses.size() == 1)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return Rotate(avoid, std::chrono::steady_clock::now(), currentWeights);
+}
+
+std::vector<size_t> EgressPool::GetUpcoming(const unsigned int& count) const
+{
+	if (egresses.size() == 1)
+		return std::vector<size_t>(count, 0);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto now(std::chrono::steady_clock::now());
+	auto weights(currentWeights);
+	std::vector<size_t> upcoming;
+	for (unsigned int i = 0; i < count; ++i)
+		upcoming.push_back(Rotate(noEgress, now, weights));
+	return upcoming;
+}
+
+// Smooth weighted round-robin:  spreads requests in proportion to weight without bursts to one route
+size_t EgressPool::Rotate(const size_t& avoid, const std::chrono::steady_clock::time_point& now, std::vector<double>& weights) const
+{
+	double totalWeight(0.0);
+	size_t selected(noEgress);
+	for (size_t i = 0; i < egresses.size(); ++i)
+	{
+		const auto& e(egresses[i]);
+		if (i == avoid || e.coolDownUntil > now)
+			continue;
+
+		const double weight(GetWeight(e));
+		weights[i] += weight;
+		totalWeight += weight;
+		if (selected == noEgress || weights[i] > weights[selected])
+			selected = i;
+	}
+
+	if (selected != noEgress)
+	{
+		weights[selected] -= totalWeight;
+		return selected;
+	}
+
+	// Everything else is resting - use whichever route comes back soonest (preferably not the one to avoid)
+	for (size_t i = 0; i < egresses.size(); ++i)
+	{
+		if (i == avoid && egresses.size() > 1)
+			continue;
+		if (selected == noEgress || egresses[i].coolDownUntil < egresses[selected].coolDownUntil)
+			selected = i;
+	}
+
+	return selected;
+}
+
+bool EgressPool::Apply(CURL* curl, const size_t& egress) const
+{
+	const auto& e(egresses[egress]);
+	if (e.type == Egress::Type::Proxy)
+		return curl_easy_setopt(curl, CURLOPT_PROXY, e.address.c_str()) == CURLE_OK;
+	else if (e.type == Egress::Type::Interface)
+		return curl_easy_setopt(curl, CURLOPT_INTERFACE, e.address.c_str()) == CURLE_OK;
+	return true;
+}
+
+void EgressPool::Record(CURL* curl, const size_t& egress, const CURLcode& result, const std::chrono::milliseconds& latency)
+{
+	// Aborted transfers were stopped on our end (shutdown or check deadline), so they say nothing about the route
+	if (result == CURLE_ABORTED_BY_CALLBACK)
+		return;
+
+	long responseCode(0);
+	curl_off_t retryAfter(0);
+	curl_off_t downloadSize(0);
+	if (curl)
+	{
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
+		curl_easy_getinfo(curl, CURLINFO_RETRY_AFTER, &retryAfter);
+		curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloadSize);
+	}
+
+	const bool rateLimited(responseCode == 429);
+	const bool succeeded(result == CURLE_OK && !rateLimited);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& e(egresses[egress]);
+	++e.requestCount;
+	e.bytesReceived += static_cast<unsigned long long>(downloadSize);
+	e.successRate += successSmoothing * ((succeeded ? 1.0 : 0.0) - e.successRate);
+
+	if (succeeded)
+	{
+		const double sample(static_cast<double>(latency.count()));
+		e.latency = e.latency > 0.0 ? e.latency + latencySmoothing * (sample - e.latency) : sample;
+		e.consecutiveRateLimits = 0;
+	}
+	else
+		++e.failureCount;
+
+	if (!rateLimited)
+		return;
+
+	// Honor Retry-After when the server sends one; otherwise back off exponentially
+	++e.rateLimitCount;
+	++e.consecutiveRateLimits;
+	std::chrono::seconds coolDown(baseCoolDown * (1 << std::min(e.consecutiveRateLimits - 1, 5U)));
+	if (retryAfter > 0)
+		coolDown = std::chrono::seconds(retryAfter);
+	e.coolDownUntil = std::chrono::steady_clock::now() + std::min(coolDown, maxCoolDown);
+}
+
+std::string EgressPool::GetName(const Egress& egress)
+{
+	if (egress.type == Egress::Type::Proxy)
+		return "proxy " + egress.address;
+	else if (egress.type == Egress::Type::Interface)
+		return "interface " + egress.address;
+	return "direct";
+}
+
+std::string EgressPool::GetSummary() const
+{
+	const auto now(std::chrono::steady_clock::now());
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	for (const auto& e : egresses)
+	{
+		if (&e != &egresses.front())
+			ss << '\n';
+
+		ss << "Egress " << GetName(e) << ":  " << e.requestCount << " requests, " << e.failureCount << " failed, "
+			<< e.rateLimitCount << " rate limited, " << e.bytesReceived / 1024.0 << " kB received, "
+			<< std::setprecision(0) << e.latency << " ms typical" << std::setprecision(1);
+		if (e.coolDownUntil > now)
+			ss << " (cooling down for " << std::chrono::duration_cast<std::chrono::seconds>(e.coolDownUntil - now).count() << " sec)";
+	}
+
+	return ss.str();
+}
@@ -0,0 +1,85 @@
+// File:  egressPool.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Set of routes (proxies or local interfaces) that requests can leave through, so polling
+//        isn't throttled as if it all came from one address.  Each request goes out the route
+//        with the best recent success rate and latency; routes that get rate-limited are rested.
+
+#ifndef EGRESS_POOL_H_
+#define EGRESS_POOL_H_
+
+// cURL headers
+#include <curl/curl.h>
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+class EgressPool
+{
+public:
+	// Each entry is "direct", "proxy=<url>" (e.g. http://127.0.0.1:3128 or socks5h://host:1080) or
+	// "interface=<name or address>".  With no valid entries, requests go out directly.
+	explicit EgressPool(const std::vector<std::string>& entries);
+
+	static const size_t noEgress;
+
+	// Select() and Record() are for the engine thread only.  If there's an alternative, avoid is
+	// never chosen (so a hedge takes a different route than its original).
+	size_t Select(const size_t& avoid = noEgress);
+	bool Apply(CURL* curl, const size_t& egress) const;
+
+	// Thread-safe; what the next count calls to Select() would return if nothing else were sent first
+	std::vector<size_t> GetUpcoming(const unsigned int& count) const;
+	void Record(CURL* curl, const size_t& egress, const CURLcode& result, const std::chrono::milliseconds& latency);
+
+	size_t GetCount() const { return egresses.size(); }
+	std::string GetSummary() const;
+
+private:
+	static const double successSmoothing;
+	static const double latencySmoothing;
+	static const double referenceLatency;// [ms]
+	static const double minimumWeight;
+	static const std::chrono::seconds baseCoolDown;
+	static const std::chrono::seconds maxCoolDown;
+
+	struct Egress
+	{
+		enum class Type
+		{
+			Direct,
+			Proxy,
+			Interface
+		};
+
+		Type type = Type::Direct;
+		std::string address;
+
+		double successRate = 1.0;// Smoothed fraction of requests that weren't refused or failed in transit
+		double latency = 0.0;// Smoothed [ms]; zero until the first response
+
+		std::chrono::steady_clock::time_point coolDownUntil;
+		unsigned int consecutiveRateLimits = 0;
+
+		unsigned long long requestCount = 0;
+		unsigned long long failureCount = 0;
+		unsigned long long rateLimitCount = 0;
+		unsigned long long bytesReceived = 0;
+	};
+
+	// Only changed on the engine thread; the mutex is for summaries and GetUpcoming(), which are requested from elsewhere
+	mutable std::mutex mutex;
+	std::vector<Egress> egresses;
+	std::vector<double> currentWeights;// For smooth weighted round-robin, by egress
+
+	size_t Rotate(const size_t& avoid, const std::chrono::steady_clock::time_point& now, std::vector<double>& weights) const;
+
+	static bool Parse(const std::string& entry, Egress& egress);
+	static double GetWeight(const Egress& egress);
+	static std::string GetName(const Egress& egress);
+};
+
+#endif// EGRESS_POOL_H_
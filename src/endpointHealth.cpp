@@ -0,0 +1,128 @@
+// File:  endpointHealth.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Health scores for the endpoints a target uses, built from HTTP errors, parse failures
+//        and records that didn't match the expected schema.  Endpoints that keep failing (e.g.
+//        after a site changes its JSON) are demoted to an occasional probe instead of being
+//        requested (and failing) on every check; a good probe restores them.
+
+// Local headers
+#include "endpointHealth.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+const double EndpointHealth::scoreWeight(0.2);
+const double EndpointHealth::demoteScore(0.25);
+const double EndpointHealth::restoreQuality(0.75);
+const double EndpointHealth::restoredScore(0.6);
+const double EndpointHealth::schemaMismatchFraction(0.5);
+const unsigned int EndpointHealth::initialProbePeriods(5);
+const unsigned int EndpointHealth::maxProbePeriods(60);
+
+EndpointHealth::Access EndpointHealth::GetAccess(const std::string_view& endpoint, const std::chrono::system_clock::time_point& now)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto it(endpoints.find(endpoint));
+	if (it == endpoints.end() || !it->second.demoted)
+		return Access::Normal;
+
+	if (now < it->second.nextProbe)
+		return Access::Skip;
+
+	// If the probe's result never arrives (e.g. the request failed in transit), try again next interval
+	it->second.nextProbe = now + checkPeriod * it->second.probePeriods;
+	return Access::Probe;
+}
+
+bool EndpointHealth::IsDemoted(const std::string_view& endpoint) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto it(endpoints.find(endpoint));
+	return it != endpoints.end() && it->second.demoted;
+}
+
+double EndpointHealth::GetScore(const std::string_view& endpoint) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const auto it(endpoints.find(endpoint));
+	return it == endpoints.end() ? 1.0 : it->second.score;
+}
+
+EndpointHealth::Transition EndpointHealth::RecordParsed(const std::string_view& endpoint, const double& goodFraction, const std::chrono::system_clock::time_point& now)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& e(endpoints.try_emplace(std::string(endpoint)).first->second);
+	++e.parsedCount;
+	if (goodFraction < 1.0)
+		++e.partialCount;
+	if (goodFraction < schemaMismatchFraction)
+		++e.schemaMismatchCount;
+	return Record(e, goodFraction, now);
+}
+
+EndpointHealth::Transition EndpointHealth::RecordParseFailure(const std::string_view& endpoint, const std::chrono::system_clock::time_point& now)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& e(endpoints.try_emplace(std::string(endpoint)).first->second);
+	++e.parseFailureCount;
+	return Record(e, 0.0, now);
+}
+
+EndpointHealth::Transition EndpointHealth::RecordHTTPError(const std::string_view& endpoint, const std::chrono::system_clock::time_point& now)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto& e(endpoints.try_emplace(std::string(endpoint)).first->second);
+	++e.httpErrorCount;
+	return Record(e, 0.0, now);
+}
+
+// While demoted, every response is treated as a probe result
+EndpointHealth::Transition EndpointHealth::Record(Endpoint& e, const double& quality, const std::chrono::system_clock::time_point& now)
+{
+	if (e.demoted)
+	{
+		if (quality >= restoreQuality)
+		{
+			e.demoted = false;
+			e.score = restoredScore;
+			return Transition::Restored;
+		}
+
+		e.probePeriods = std::min(e.probePeriods * 2, maxProbePeriods);
+		e.nextProbe = now + checkPeriod * e.probePeriods;
+		return Transition::None;
+	}
+
+	e.score = e.score * (1.0 - scoreWeight) + quality * scoreWeight;
+	if (e.score >= demoteScore)
+		return Transition::None;
+
+	e.demoted = true;
+	++e.demotionCount;
+	e.probePeriods = initialProbePeriods;
+	e.nextProbe = now + checkPeriod * e.probePeriods;
+	return Transition::Demoted;
+}
+
+void EndpointHealth::AddStatus(cJSON* status) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	cJSON* array(cJSON_AddArrayToObject(status, "endpoints"));
+	for (const auto& e : endpoints)
+	{
+		cJSON* endpoint(cJSON_CreateObject());
+		cJSON_AddStringToObject(endpoint, "endpoint", e.first.c_str());
+		cJSON_AddNumberToObject(endpoint, "score", e.second.score);
+		cJSON_AddBoolToObject(endpoint, "demoted", e.second.demoted);
+		if (e.second.demoted)
+			cJSON_AddNumberToObject(endpoint, "nextProbe", std::chrono::duration<double>(e.second.nextProbe.time_since_epoch()).count());
+		cJSON_AddNumberToObject(endpoint, "parsed", static_cast<double>(e.second.parsedCount));
+		cJSON_AddNumberToObject(endpoint, "partial", static_cast<double>(e.second.partialCount));
+		cJSON_AddNumberToObject(endpoint, "schemaMismatches", static_cast<double>(e.second.schemaMismatchCount));
+		cJSON_AddNumberToObject(endpoint, "parseFailures", static_cast<double>(e.second.parseFailureCount));
+		cJSON_AddNumberToObject(endpoint, "httpErrors", static_cast<double>(e.second.httpErrorCount));
+		cJSON_AddNumberToObject(endpoint, "demotions", static_cast<double>(e.second.demotionCount));
+		cJSON_AddItemToArray(array, endpoint);
+	}
+}
@@ -0,0 +1,87 @@
+// File:  endpointHealth.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Health scores for the endpoints a target uses, built from HTTP errors, parse failures
+//        and records that didn't match the expected schema.  Endpoints that keep failing (e.g.
+//        after a site changes its JSON) are demoted to an occasional probe instead of being
+//        requested (and failing) on every check; a good probe restores them.
+
+#ifndef ENDPOINT_HEALTH_H_
+#define ENDPOINT_HEALTH_H_
+
+// Local headers
+#include "email/cJSON/cJSON.h"
+
+// Standard C++ headers
+#include <string>
+#include <string_view>
+#include <map>
+#include <mutex>
+#include <chrono>
+
+class EndpointHealth
+{
+public:
+	explicit EndpointHealth(const std::chrono::system_clock::duration& checkPeriod) : checkPeriod(checkPeriod) {}
+
+	enum class Access
+	{
+		Normal,
+		Probe,// Demoted, but due for a probe; keep it to a single request
+		Skip
+	};
+
+	// A probe is handed out once per probe interval, so call once per check (not per request)
+	Access GetAccess(const std::string_view& endpoint, const std::chrono::system_clock::time_point& now);
+	bool IsDemoted(const std::string_view& endpoint) const;
+
+	enum class Transition
+	{
+		None,
+		Demoted,
+		Restored
+	};
+
+	// goodFraction is the fraction of records in a parsed response that had every expected field
+	Transition RecordParsed(const std::string_view& endpoint, const double& goodFraction, const std::chrono::system_clock::time_point& now);
+	Transition RecordParseFailure(const std::string_view& endpoint, const std::chrono::system_clock::time_point& now);
+	Transition RecordHTTPError(const std::string_view& endpoint, const std::chrono::system_clock::time_point& now);
+
+	double GetScore(const std::string_view& endpoint) const;
+
+	// Adds an "endpoints" array to status
+	void AddStatus(cJSON* status) const;
+
+private:
+	const std::chrono::system_clock::duration checkPeriod;
+
+	static const double scoreWeight;// For the exponentially weighted score
+	static const double demoteScore;
+	static const double restoreQuality;// A probe at least this good restores the endpoint
+	static const double restoredScore;// Starting score after a restore, so one bad response doesn't demote it again
+	static const double schemaMismatchFraction;// Responses with more bad records than this count as schema mismatches
+	static const unsigned int initialProbePeriods;// Check periods between probes; doubles after each failed probe
+	static const unsigned int maxProbePeriods;
+
+	struct Endpoint
+	{
+		double score = 1.0;
+		bool demoted = false;
+		unsigned int probePeriods = 0;
+		std::chrono::system_clock::time_point nextProbe;
+
+		unsigned long long parsedCount = 0;
+		unsigned long long partialCount = 0;// Parsed, but some records were skipped
+		unsigned long long schemaMismatchCount = 0;
+		unsigned long long parseFailureCount = 0;
+		unsigned long long httpErrorCount = 0;
+		unsigned long long demotionCount = 0;
+	};
+
+	mutable std::mutex mutex;
+	std::map<std::string, Endpoint, std::less<>> endpoints;
+
+	Transition Record(Endpoint& e, const double& quality, const std::chrono::system_clock::time_point& now);
+};
+
+#endif// ENDPOINT_HEALTH_H_
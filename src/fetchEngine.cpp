@@ -0,0 +1,491 @@
+// File:  fetchEngine.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Shared cURL multi interface that runs all target transfers on one thread, multiplexing
+//        requests to the same host over HTTP/2 where the server supports it.
+
+// Local headers
+#include "fetchEngine.h"
+#include "utilities/uString.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+const unsigned int FetchEngine::defaultMaxConcurrentStreams(16);
+const unsigned int FetchEngine::maxConnectionsPerHost(4);
+const double FetchEngine::defaultHedgeBudget(0.05);
+const double FetchEngine::maxHedgeTokens(10.0);
+const unsigned int FetchEngine::EndpointLatency::minimumSamples(20);
+
+FetchEngine::FetchEngine(const unsigned int& maxConcurrentStreams, const double& hedgeBudget, const std::vector<std::string>& egresses)
+	: multi(curl_multi_init()), maxActiveTransfers(maxConcurrentStreams * maxConnectionsPerHost), egressPool(egresses), hedgeBudget(hedgeBudget)
+{
+	if (!multi)
+	{
+		Cerr << "Failed to initialize CURL multi handle\n";
+		return;
+	}
+
+	// Requests to a host we're already connected to wait for a stream on that connection instead of opening another.
+	// If the server only speaks HTTP/1.1, the per-host connection cap keeps bursts from opening a socket per request.
+	curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	curl_multi_setopt(multi, CURLMOPT_MAX_CONCURRENT_STREAMS, static_cast<long>(maxConcurrentStreams));
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(maxConnectionsPerHost));
+
+	// The idle cache is otherwise sized to the handles in use, which is nearly none between checks; keep warmed-up connections
+	curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(maxActiveTransfers));
+
+	engineThread = std::thread(&FetchEngine::ThreadEntry, this);
+}
+
+FetchEngine::~FetchEngine()
+{
+	stop = true;
+	if (multi)
+		curl_multi_wakeup(multi);
+	if (engineThread.joinable())
+		engineThread.join();
+
+	for (auto& h : idleHandles)
+		curl_easy_cleanup(h);
+
+	if (multi)
+		curl_multi_cleanup(multi);
+}
+
+void FetchEngine::Submit(Transfer* transfer, std::string_view endpoint, Transfer* hedge, const Priority& priority, const size_t& egress)
+{
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		pendingTransfers.push_back({ transfer, endpoint, hedge, priority, egress });
+	}
+
+	curl_multi_wakeup(multi);
+}
+
+void FetchEngine::CancelAbandoned()
+{
+	cancelSweepRequested = true;
+	curl_multi_wakeup(multi);
+}
+
+void FetchEngine::ThreadEntry()
+{
+	int runningCount(0);
+	while (!stop)
+	{
+		if (cancelSweepRequested.exchange(false))
+			AbortCancelledTransfers();
+
+		StartPendingTransfers();
+		const int timeout(StartDueHedges());
+		curl_multi_perform(multi, &runningCount);
+		ProcessCompletedTransfers();
+
+		// Don't wait if finished transfers have made room for waiting ones
+		if (!waitingTransfers.empty() && activeTransfers.size() < maxActiveTransfers)
+			continue;
+		curl_multi_poll(multi, nullptr, 0, timeout, nullptr);
+	}
+
+	// Anything still waiting or in flight is abandoned; let the owners know so nobody waits forever
+	StartPendingTransfers();
+	for (const auto& pending : waitingTransfers)
+		pending.transfer->Complete(nullptr, CURLE_ABORTED_BY_CALLBACK);
+	waitingTransfers.clear();
+
+	while (!activeTransfers.empty())
+	{
+		const auto it(activeTransfers.begin());
+		CURL* curl(it->first);
+		const ActiveTransfer info(it->second);
+		activeTransfers.erase(it);
+		curl_multi_remove_handle(multi, curl);
+
+		if (info.partner)
+		{
+			activeTransfers.at(info.partner).partner = nullptr;
+			info.transfer->Cancelled(curl);
+		}
+		else
+			info.transfer->Complete(curl, CURLE_ABORTED_BY_CALLBACK);
+		idleHandles.push_back(curl);
+	}
+}
+
+CURL* FetchEngine::GetIdleHandle()
+{
+	if (idleHandles.empty())
+		return curl_easy_init();
+
+	CURL* curl(idleHandles.back());
+	idleHandles.pop_back();
+	curl_easy_reset(curl);
+	return curl;
+}
+
+// cURL only reuses a connection for a handle with the same proxy and interface, so each egress keeps its own connections
+CURL* FetchEngine::StartTransfer(const ActiveTransfer& info, const size_t& egress)
+{
+	CURL* curl(GetIdleHandle());
+	if (!curl)
+		return nullptr;
+
+	if (!egressPool.Apply(curl, egress))
+	{
+		idleHandles.push_back(curl);
+		return nullptr;
+	}
+
+	// CURL_HTTP_VERSION_2TLS negotiates HTTP/2 via ALPN and falls back to HTTP/1.1 if the server doesn't offer it
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+	// A warm-up is sent once for each connection it's meant to open, so it mustn't wait to share one
+	curl_easy_setopt(curl, CURLOPT_PIPEWAIT, info.isWarmUp ? 0L : 1L);
+
+	if (!info.transfer->Configure(curl) || curl_multi_add_handle(multi, curl) != CURLM_OK)
+	{
+		idleHandles.push_back(curl);
+		return nullptr;
+	}
+
+	auto& active(activeTransfers[curl] = info);
+	active.egress = egress;
+	active.sentTime = std::chrono::steady_clock::now();
+	return curl;
+}
+
+void FetchEngine::StartPendingTransfers()
+{
+	std::vector<PendingTransfer> newTransfers;
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex);
+		newTransfers.swap(pendingTransfers);
+	}
+
+	for (const auto& pending : newTransfers)
+	{
+		// Warm-ups are only worth anything if they finish before the requests they're for are sent
+		if (pending.priority != Priority::Routine)
+			StartPendingTransfer(pending);
+		else
+			waitingTransfers.push_back(pending);
+	}
+
+	while (!waitingTransfers.empty() && activeTransfers.size() < maxActiveTransfers)
+	{
+		StartPendingTransfer(waitingTransfers.front());
+		waitingTransfers.pop_front();
+	}
+}
+
+void FetchEngine::StartPendingTransfer(const PendingTransfer& pending)
+{
+	const auto now(std::chrono::steady_clock::now());
+	ActiveTransfer info;
+	info.transfer = pending.transfer;
+	info.startTime = now;
+	info.isWarmUp = pending.priority == Priority::WarmUp;
+
+	if (!pending.endpoint.empty())
+	{
+		{
+			std::lock_guard<std::mutex> lock(endpointsMutex);
+			auto it(endpoints.find(pending.endpoint));
+			if (it == endpoints.end())
+				it = endpoints.emplace(std::string(pending.endpoint), EndpointLatency()).first;
+			info.endpoint = &it->second;
+		}
+
+		if (pending.hedge && hedgeBudget > 0.0)
+		{
+			++hedgeEligibleCount;
+			hedgeTokens = std::min(hedgeTokens + hedgeBudget, maxHedgeTokens);
+
+			const auto delay(info.endpoint->GetHedgeDelay());
+			if (delay > std::chrono::milliseconds::zero())
+			{
+				info.hedge = pending.hedge;
+				info.hedgeTime = now + delay;
+			}
+		}
+	}
+
+	if (!StartTransfer(info, pending.egress == EgressPool::noEgress ? egressPool.Select() : pending.egress))
+		pending.transfer->Complete(nullptr, CURLE_FAILED_INIT);
+	else if (info.isWarmUp)
+		++warmUpCount;
+}
+
+int FetchEngine::StartDueHedges()
+{
+	const auto now(std::chrono::steady_clock::now());
+	auto nextHedgeTime(now + std::chrono::seconds(1));
+
+	dueHedges.clear();
+	for (auto& active : activeTransfers)
+	{
+		auto& info(active.second);
+		if (!info.hedge)
+			continue;
+
+		if (info.hedgeTime > now)
+			nextHedgeTime = std::min(nextHedgeTime, info.hedgeTime);
+		else if (hedgeTokens < 1.0)
+			info.hedge = nullptr;// Out of budget - let the original run
+		else
+			dueHedges.push_back(active.first);
+	}
+
+	for (const auto& primary : dueHedges)
+	{
+		ActiveTransfer hedgeInfo;
+		size_t primaryEgress;
+		{
+			auto& primaryInfo(activeTransfers.at(primary));
+			hedgeInfo.transfer = primaryInfo.hedge;
+			hedgeInfo.endpoint = primaryInfo.endpoint;
+			hedgeInfo.startTime = primaryInfo.startTime;
+			hedgeInfo.partner = primary;
+			hedgeInfo.isHedge = true;
+			primaryInfo.hedge = nullptr;
+			primaryEgress = primaryInfo.egress;
+		}
+
+		CURL* hedgeCurl(StartTransfer(hedgeInfo, egressPool.Select(primaryEgress)));
+		if (!hedgeCurl)
+			continue;
+
+		activeTransfers.at(primary).partner = hedgeCurl;
+		hedgeTokens -= 1.0;
+		++hedgeCount;
+	}
+
+	return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(nextHedgeTime - now).count());
+}
+
+void FetchEngine::CancelTransfer(CURL* curl)
+{
+	const auto it(activeTransfers.find(curl));
+	const ActiveTransfer info(it->second);
+	activeTransfers.erase(it);
+	curl_multi_remove_handle(multi, curl);
+
+	info.transfer->Cancelled(curl);
+	idleHandles.push_back(curl);
+}
+
+void FetchEngine::AbortCancelledTransfers()
+{
+	for (auto it = waitingTransfers.begin(); it != waitingTransfers.end();)
+	{
+		if (it->transfer->IsCancelled())
+		{
+			it->transfer->Complete(nullptr, CURLE_ABORTED_BY_CALLBACK);
+			it = waitingTransfers.erase(it);
+		}
+		else
+			++it;
+	}
+
+	std::vector<CURL*> cancelled;
+	for (const auto& active : activeTransfers)
+	{
+		// A started hedge is cancelled along with its original
+		if ((!active.second.isHedge || !active.second.partner) && active.second.transfer->IsCancelled())
+			cancelled.push_back(active.first);
+	}
+
+	for (const auto& curl : cancelled)
+	{
+		const auto it(activeTransfers.find(curl));
+		const ActiveTransfer info(it->second);
+		if (info.partner)
+			CancelTransfer(info.partner);
+
+		activeTransfers.erase(curl);
+		curl_multi_remove_handle(multi, curl);
+		info.transfer->Complete(curl, CURLE_ABORTED_BY_CALLBACK);
+		idleHandles.push_back(curl);
+	}
+
+	// Requests parked behind another target's transfer would otherwise wait for it to finish
+	coalescer.ReleaseCancelled();
+}
+
+void FetchEngine::ProcessCompletedTransfers()
+{
+	int messagesInQueue;
+	while (CURLMsg* message = curl_multi_info_read(multi, &messagesInQueue))
+	{
+		if (message->msg != CURLMSG_DONE)
+			continue;
+
+		CURL* curl(message->easy_handle);
+		const CURLcode result(message->data.result);
+		const auto it(activeTransfers.find(curl));
+		const ActiveTransfer info(it->second);
+		activeTransfers.erase(it);
+		curl_multi_remove_handle(multi, curl);
+
+		RecordEgress(curl, info, result);
+
+		// Warm-ups are expected to connect; what matters is whether the requests after them had to
+		if (!info.isWarmUp && result == CURLE_OK)
+		{
+			long connectCount(0);
+			curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connectCount);
+			++requestCount;
+			if (connectCount > 0)
+				++coldRequestCount;
+		}
+
+		if (info.partner)
+		{
+			// If one half of a hedge pair fails, give the other a chance to finish
+			if (result != CURLE_OK)
+			{
+				activeTransfers.at(info.partner).partner = nullptr;
+				info.transfer->Cancelled(curl);
+				idleHandles.push_back(curl);
+				continue;
+			}
+
+			CancelTransfer(info.partner);
+		}
+
+		if (info.endpoint && result == CURLE_OK)
+		{
+			const auto elapsed(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - info.startTime));
+			if (info.isHedge)
+			{
+				// We don't know when the cancelled original would have finished; estimate with the endpoint's typical slow response
+				++hedgeWinCount;
+				if (info.endpoint->GetTailMean() > elapsed)
+					hedgeSavedTime += static_cast<unsigned long long>((info.endpoint->GetTailMean() - elapsed).count());
+			}
+
+			std::lock_guard<std::mutex> lock(endpointsMutex);
+			info.endpoint->Record(elapsed);
+		}
+
+		info.transfer->Complete(curl, result);
+		idleHandles.push_back(curl);
+	}
+}
+
+void FetchEngine::RecordEgress(CURL* curl, const ActiveTransfer& info, const CURLcode& result)
+{
+	const auto elapsed(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - info.sentTime));
+	egressPool.Record(curl, info.egress, result, elapsed);
+}
+
+void FetchEngine::EndpointLatency::Record(const std::chrono::milliseconds& latency)
+{
+	samples[sampleCount % samples.size()] = latency;
+	++sampleCount;
+
+	// Percentiles don't move much sample-to-sample, so only update them every so often
+	if (sampleCount < minimumSamples || sampleCount % 8 != 0)
+		return;
+
+	const size_t count(std::min<size_t>(sampleCount, samples.size()));
+	auto sorted(samples);
+	std::sort(sorted.begin(), sorted.begin() + count);
+
+	const size_t p95Index(count * 95 / 100);
+	hedgeDelay = sorted[p95Index];
+
+	std::chrono::milliseconds tailSum(0);
+	for (size_t i = p95Index; i < count; ++i)
+		tailSum += sorted[i];
+	tailMean = tailSum / static_cast<long long>(count - p95Index);
+}
+
+void FetchEngine::EndpointLatency::Save(SnapshotWriter& writer) const
+{
+	const unsigned int count(std::min<unsigned int>(sampleCount, static_cast<unsigned int>(samples.size())));
+	writer.Write(sampleCount);
+	for (unsigned int i = 0; i < count; ++i)
+		writer.Write(static_cast<unsigned long long>(samples[i].count()));
+	writer.Write(static_cast<unsigned long long>(hedgeDelay.count()));
+	writer.Write(static_cast<unsigned long long>(tailMean.count()));
+}
+
+bool FetchEngine::EndpointLatency::Load(SnapshotReader& reader)
+{
+	if (!reader.Read(sampleCount))
+		return false;
+
+	const unsigned int count(std::min<unsigned int>(sampleCount, static_cast<unsigned int>(samples.size())));
+	unsigned long long value;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (!reader.Read(value))
+			return false;
+		samples[i] = std::chrono::milliseconds(value);
+	}
+
+	if (!reader.Read(value))
+		return false;
+	hedgeDelay = std::chrono::milliseconds(value);
+
+	if (!reader.Read(value))
+		return false;
+	tailMean = std::chrono::milliseconds(value);
+
+	return true;
+}
+
+void FetchEngine::SaveState(SnapshotWriter& writer) const
+{
+	std::lock_guard<std::mutex> lock(endpointsMutex);
+	writer.Write(static_cast<unsigned int>(endpoints.size()));
+	for (const auto& e : endpoints)
+	{
+		writer.Write(e.first);
+		e.second.Save(writer);
+	}
+}
+
+bool FetchEngine::LoadState(SnapshotReader& reader)
+{
+	unsigned int count;
+	if (!reader.Read(count))
+		return false;
+
+	std::lock_guard<std::mutex> lock(endpointsMutex);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		std::string name;
+		if (!reader.Read(name) || !endpoints[name].Load(reader))
+			return false;
+	}
+
+	return true;
+}
+
+std::string FetchEngine::GetHedgeSummary() const
+{
+	const unsigned long long eligible(hedgeEligibleCount);
+	const unsigned long long hedged(hedgeCount);
+
+	std::ostringstream ss;
+	ss << "Hedged " << hedged << " of " << eligible << " requests (" << std::fixed << std::setprecision(1)
+		<< (eligible > 0 ? 100.0 * hedged / eligible : 0.0) << "%); " << hedgeWinCount << " hedges finished first, saving an estimated "
+		<< hedgeSavedTime / 1000.0 << " sec";
+	return ss.str();
+}
+
+std::string FetchEngine::GetWarmUpSummary() const
+{
+	const unsigned long long requests(requestCount);
+	const unsigned long long cold(coldRequestCount);
+
+	std::ostringstream ss;
+	ss << "Sent " << warmUpCount << " warm-up requests; " << cold << " of " << requests << " requests had to open a connection ("
+		<< std::fixed << std::setprecision(1) << (requests > 0 ? 100.0 * cold / requests : 0.0) << "%)";
+	return ss.str();
+}
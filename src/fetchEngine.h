@@ -0,0 +1,191 @@
+// File:  fetchEngine.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Shared cURL multi interface that runs all target transfers on one thread, multiplexing
+//        requests to the same host over HTTP/2 where the server supports it.
+
+#ifndef FETCH_ENGINE_H_
+#define FETCH_ENGINE_H_
+
+// Local headers
+#include "snapshot.h"
+#include "egressPool.h"
+#include "requestCoalescer.h"
+
+// cURL headers
+#include <curl/curl.h>
+
+// Standard C++ headers
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <deque>
+#include <array>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <string_view>
+#include <chrono>
+
+class FetchEngine
+{
+public:
+	explicit FetchEngine(const unsigned int& maxConcurrentStreams = defaultMaxConcurrentStreams,
+		const double& hedgeBudget = defaultHedgeBudget, const std::vector<std::string>& egresses = std::vector<std::string>());
+	~FetchEngine();
+
+	static const unsigned int defaultMaxConcurrentStreams;
+	static const unsigned int maxConnectionsPerHost;
+	static const double defaultHedgeBudget;
+
+	// Implemented by anything that wants to make a request through the engine.  All methods are
+	// called on the engine thread, so they must not block.
+	class Transfer
+	{
+	public:
+		virtual ~Transfer() = default;
+
+		// Set URL, write callback, etc.; engine-wide options (HTTP version, etc.) are already set
+		virtual bool Configure(CURL* curl) = 0;
+
+		// Handle is still valid here (for curl_easy_getinfo), but is reused as soon as this returns
+		virtual void Complete(CURL* curl, const CURLcode& result) = 0;
+
+		// Called instead of Complete() for a hedge pair's losing transfer
+		virtual void Cancelled(CURL*) {}
+
+		// Checked after CancelAbandoned(); cancelled transfers complete right away with CURLE_ABORTED_BY_CALLBACK
+		virtual bool IsCancelled() const { return false; }
+	};
+
+	enum class Priority
+	{
+		Routine,
+		Confirmation,// Skips ahead of any routine transfers waiting to start
+		WarmUp// Opens a connection for a later request; starts right away and isn't counted as one of the requests it warms up for
+	};
+
+	// Caller must keep the transfer alive until Complete() has been called.  Latency is tracked per
+	// endpoint; if a hedge transfer is given and the request is still outstanding after that endpoint's
+	// p95 latency, the hedge is started too (budget permitting).  Only the first of the two to finish
+	// is completed; once it has been, the engine won't touch either one again.  Unless an egress is
+	// given (see GetUpcomingEgresses()), the egress pool picks one.
+	void Submit(Transfer* transfer, std::string_view endpoint = std::string_view(),
+		Transfer* hedge = nullptr, const Priority& priority = Priority::Routine, const size_t& egress = EgressPool::noEgress);
+
+	// Call after cancelling transfers (see Transfer::IsCancelled()) to have them finish without waiting for the network
+	void CancelAbandoned();
+
+	// The egresses the next count requests are expected to take, so connections can be opened ahead of them
+	std::vector<size_t> GetUpcomingEgresses(const unsigned int& count) const { return egressPool.GetUpcoming(count); }
+
+	std::string GetHedgeSummary() const;
+	std::string GetWarmUpSummary() const;
+	std::string GetEgressSummary() const { return egressPool.GetSummary(); }
+
+	// Lets identical requests from different targets share one transfer
+	RequestCoalescer& GetCoalescer() { return coalescer; }
+
+	// Learned per-endpoint latencies, so hedging doesn't have to wait for new samples after a restart
+	void SaveState(SnapshotWriter& writer) const;
+	bool LoadState(SnapshotReader& reader);
+
+private:
+	CURLM* multi;
+
+	struct PendingTransfer
+	{
+		Transfer* transfer;
+		std::string_view endpoint;
+		Transfer* hedge;
+		Priority priority;
+		size_t egress;
+	};
+
+	std::mutex pendingMutex;
+	std::vector<PendingTransfer> pendingTransfers;
+
+	// Routine transfers wait here rather than in cURL's queue, so confirmations can go ahead of them
+	const size_t maxActiveTransfers;
+	std::deque<PendingTransfer> waitingTransfers;
+
+	class EndpointLatency
+	{
+	public:
+		void Record(const std::chrono::milliseconds& latency);
+
+		// Zero until there are enough samples to trust
+		std::chrono::milliseconds GetHedgeDelay() const { return hedgeDelay; }
+		std::chrono::milliseconds GetTailMean() const { return tailMean; }
+
+		void Save(SnapshotWriter& writer) const;
+		bool Load(SnapshotReader& reader);
+
+	private:
+		static const unsigned int minimumSamples;
+		std::array<std::chrono::milliseconds, 128> samples;
+		unsigned int sampleCount = 0;
+
+		std::chrono::milliseconds hedgeDelay = std::chrono::milliseconds::zero();// p95
+		std::chrono::milliseconds tailMean = std::chrono::milliseconds::zero();// Mean of samples above p95
+	};
+
+	// Only changed on the engine thread; the mutex is for snapshots, which are taken from elsewhere
+	mutable std::mutex endpointsMutex;
+	std::map<std::string, EndpointLatency, std::less<>> endpoints;
+
+	struct ActiveTransfer
+	{
+		Transfer* transfer;
+		EndpointLatency* endpoint = nullptr;
+		std::chrono::steady_clock::time_point startTime;// Of the original request, for hedges too
+
+		Transfer* hedge = nullptr;// Not yet started
+		std::chrono::steady_clock::time_point hedgeTime;
+
+		CURL* partner = nullptr;// The other half of a started hedge pair
+		bool isHedge = false;
+		bool isWarmUp = false;
+
+		size_t egress = EgressPool::noEgress;
+		std::chrono::steady_clock::time_point sentTime;// Of this transfer, for egress latency
+	};
+
+	EgressPool egressPool;
+	RequestCoalescer coalescer;
+
+	std::vector<CURL*> idleHandles;
+	std::unordered_map<CURL*, ActiveTransfer> activeTransfers;
+	CURL* GetIdleHandle();
+	CURL* StartTransfer(const ActiveTransfer& info, const size_t& egress);
+	void RecordEgress(CURL* curl, const ActiveTransfer& info, const CURLcode& result);
+
+	void StartPendingTransfers();
+	void StartPendingTransfer(const PendingTransfer& pending);
+	void ProcessCompletedTransfers();
+	int StartDueHedges();// Returns the time until the next hedge is due [ms]
+	void CancelTransfer(CURL* curl);
+
+	std::atomic<unsigned long long> warmUpCount = 0;
+	std::atomic<unsigned long long> requestCount = 0;// Excluding warm-ups
+	std::atomic<unsigned long long> coldRequestCount = 0;// Requests that had to open a connection
+
+	std::atomic<bool> cancelSweepRequested = false;
+	void AbortCancelledTransfers();
+
+	const double hedgeBudget;// Fraction of eligible requests that may be duplicated
+	static const double maxHedgeTokens;// Limits bursts of hedges after a quiet period
+	double hedgeTokens = 0.0;
+	std::vector<CURL*> dueHedges;
+	std::atomic<unsigned long long> hedgeEligibleCount = 0;
+	std::atomic<unsigned long long> hedgeCount = 0;
+	std::atomic<unsigned long long> hedgeWinCount = 0;
+	std::atomic<unsigned long long> hedgeSavedTime = 0;// [ms]
+
+	std::atomic<bool> stop = false;
+	std::thread engineThread;
+	void ThreadEntry();
+};
+
+#endif// FETCH_ENGINE_H_
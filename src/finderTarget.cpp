@@ -6,24 +6,59 @@
 // Local headers
 #include "finderTarget.h"
 #include "mainFrame.h"
+#include "email/curlUtilities.h"
 
 // wxWidgets headers
 #include <wx/wx.h>
 
-const UString::String FinderTarget::userAgent(_T("vaccineFinder"));
+// Standard C++ headers
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <cctype>
 
-FinderTarget::FinderTarget(const UString::String& url, MainFrame* mainFrame,
-	const unsigned int& checkPeriodSeconds, const UString::String& name) : JSONInterface(userAgent), url(url), name(name),
-	checkPeriod(std::chrono::seconds(checkPeriodSeconds)), mainFrame(mainFrame)
+const std::string FinderTarget::userAgent("vaccineFinder");
+const size_t FinderTarget::defaultMaxResponseSize(16 * 1024 * 1024);
+const double FinderTarget::jitterFraction(0.05);
+const std::chrono::milliseconds FinderTarget::requestTimeout(std::chrono::seconds(30));
+const std::chrono::milliseconds FinderTarget::connectTimeout(std::chrono::seconds(10));
+const std::chrono::steady_clock::duration FinderTarget::maxCheckDuration(std::chrono::seconds(90));
+const std::chrono::system_clock::duration FinderTarget::cookieExpiryMargin(std::chrono::minutes(5));
+const std::chrono::system_clock::duration FinderTarget::maxSessionAge(std::chrono::minutes(30));
+const std::chrono::system_clock::duration FinderTarget::warmUpLead(std::chrono::seconds(2));
+
+FinderTarget::FinderTarget(const std::string& url, MainFrame* mainFrame, FetchEngine* fetchEngine,
+	const unsigned int& checkPeriodSeconds, const std::string& name, const std::string& cookieFile) : JSONInterface(UString::ToStringType(userAgent)), url(url), name(name),
+	checkPeriod(std::chrono::seconds(checkPeriodSeconds)), mainFrame(mainFrame), fetchEngine(fetchEngine), endpointHealth(checkPeriod), maxResponseSize(defaultMaxResponseSize), cookieFile(cookieFile)
 {
-	BeginCheckLoop();
+	if (cookieFile.empty())
+		return;
+
+	cookieShare = curl_share_init();
+	if (!cookieShare)
+	{
+		Cerr << "Failed to initialize CURL share\n";
+		return;
+	}
+
+	curl_share_setopt(cookieShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+	curl_share_setopt(cookieShare, CURLSHOPT_LOCKFUNC, LockCookieShare);
+	curl_share_setopt(cookieShare, CURLSHOPT_UNLOCKFUNC, UnlockCookieShare);
+	curl_share_setopt(cookieShare, CURLSHOPT_USERDATA, this);
 }
 
 FinderTarget::~FinderTarget()
 {
 	Stop();
-	if (checkThread.joinable())
-		checkThread.join();
+	Join();
+
+	if (cookieShare)
+	{
+		if (!simulation && cookiesChanged && !detached)
+			SaveCookies();
+		curl_share_cleanup(cookieShare);
+	}
 }
 
 void FinderTarget::BeginCheckLoop()
@@ -31,19 +66,634 @@ void FinderTarget::BeginCheckLoop()
 	checkThread = std::thread(&FinderTarget::CheckThreadEntry, this);
 }
 
+std::string FinderTarget::GetHost() const
+{
+	const auto schemeEnd(url.find("://"));
+	const auto hostStart(schemeEnd == std::string::npos ? 0 : schemeEnd + 3);
+	return url.substr(hostStart, url.find_first_of("/?#", hostStart) - hostStart);
+}
+
+void FinderTarget::Join()
+{
+	if (checkThread.joinable())
+		checkThread.join();
+}
+
+void FinderTarget::RestoreState(const std::string& snapshot)
+{
+	SnapshotReader reader(snapshot);
+	if (!snapshot.empty() && !LoadState(reader))
+		SendLogMessage(name + " saved state is incomplete; some of it was not restored");
+}
+
+std::string FinderTarget::GetStateSnapshot() const
+{
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	return stateSnapshot;
+}
+
+// Cookies go to their own file, which is also kept current here so a crash doesn't lose the session (but
+// it's only rewritten when a response has actually set a cookie)
+void FinderTarget::CaptureState()
+{
+	if (cookieShare && !simulation && cookiesChanged.exchange(false))
+	{
+		std::lock_guard<std::mutex> lock(sinkMutex);
+		if (!detached)
+			SaveCookies();
+	}
+
+	SnapshotWriter writer;
+	SaveState(writer);
+
+	std::lock_guard<std::mutex> lock(snapshotMutex);
+	stateSnapshot = writer.GetData();
+}
+
+void FinderTarget::SaveState(SnapshotWriter& writer) const
+{
+	writer.Write(hasSession);
+	writer.Write(sessionRefreshedTime);
+	writer.Write(sessionExpiryTime);
+	responseBuffers.Save(writer);
+}
+
+bool FinderTarget::LoadState(SnapshotReader& reader)
+{
+	return reader.Read(hasSession) &&
+		reader.Read(sessionRefreshedTime) &&
+		reader.Read(sessionExpiryTime) &&
+		responseBuffers.Load(reader);
+}
+
+void FinderTarget::Detach()
+{
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	mainFrame = nullptr;
+	fetchEngine = nullptr;
+	availabilityTable = nullptr;
+	subscriptionEngine = nullptr;
+	detached = true;
+}
+
 void FinderTarget::SendLogMessage(const std::string& s) const
 {
-	wxTheApp->GetTopWindow()->GetEventHandler()->CallAfter(std::bind(&MainFrame::SendMessageForHistory, mainFrame, s));
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	if (!mainFrame)
+		return;
+
+	MainFrame::UIEvent event;
+	event.type = MainFrame::UIEvent::Type::Log;
+	event.source = name;
+	event.text = s;
+	mainFrame->PostUIEvent(std::move(event));
 }
 
 bool FinderTarget::OnAppointmentsAvailable(const std::string& appointmentInfo)
 {
-	wxTheApp->GetTopWindow()->GetEventHandler()->CallAfter(std::bind(&MainFrame::SendMessageForHistory, mainFrame, UString::ToNarrowString(url) + "\n" + appointmentInfo));
-	wxTheApp->GetTopWindow()->GetEventHandler()->CallAfter(std::bind(&MainFrame::DoAppointmentNotification, mainFrame, UString::ToNarrowString(url) + "\n" + appointmentInfo));
+	if (simulation)
+		simulation->OnAppointmentsAvailable(appointmentInfo);
+
+	{
+		std::lock_guard<std::mutex> lock(sinkMutex);
+		if (!mainFrame)
+			return true;
+
+		MainFrame::UIEvent event;
+		event.type = MainFrame::UIEvent::Type::Appointment;
+		event.source = name;
+		event.text = url + "\n" + appointmentInfo;
+		mainFrame->PostUIEvent(std::move(event));
+	}
+
+	cJSON* data(cJSON_CreateObject());
+	cJSON_AddStringToObject(data, "target", name.c_str());
+	cJSON_AddNumberToObject(data, "time", ToUnixTime(Now()));
+	cJSON_AddStringToObject(data, "message", appointmentInfo.c_str());
+	PostStatusEvent("appointment", data);
 
 	return true;
 }
 
+void FinderTarget::PublishStatus()
+{
+	{
+		std::lock_guard<std::mutex> lock(sinkMutex);
+		if (!mainFrame)
+			return;
+	}
+
+	cJSON* status(cJSON_CreateObject());
+	cJSON_AddStringToObject(status, "name", name.c_str());
+	cJSON_AddStringToObject(status, "url", url.c_str());
+	cJSON_AddStringToObject(status, "state", state == State::FollowUpCheck ? "followUp" : "normal");
+	cJSON_AddNumberToObject(status, "lastCheck", ToUnixTime(lastCheckTime));
+	cJSON_AddBoolToObject(status, "lastCheckFound", lastCheckFound);
+	cJSON_AddStringToObject(status, "lastFoundMessage", lastFoundMessage.c_str());
+
+	const auto health(GetHealth());
+	cJSON_AddNumberToObject(status, "checks", static_cast<double>(health.checkCount));
+	cJSON_AddNumberToObject(status, "p99CheckDuration", std::chrono::duration<double>(health.p99CheckDuration).count());
+
+	const auto statistics(GetTransferStatistics());
+	cJSON* transfers(cJSON_AddObjectToObject(status, "transfers"));
+	cJSON_AddNumberToObject(transfers, "requests", static_cast<double>(statistics.requestCount));
+	cJSON_AddNumberToObject(transfers, "wireBytes", static_cast<double>(statistics.wireBytes));
+	cJSON_AddNumberToObject(transfers, "decodedBytes", static_cast<double>(statistics.decodedBytes));
+	cJSON_AddNumberToObject(transfers, "shared", static_cast<double>(statistics.sharedCount));
+
+	endpointHealth.AddStatus(status);
+	AddStatus(status);
+	std::string json(PrintJSON(status));
+
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	if (mainFrame)
+		mainFrame->PublishStatus(name, std::move(json));
+}
+
+void FinderTarget::PostStatusEvent(const std::string& type, cJSON* data) const
+{
+	std::string json(PrintJSON(data));
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	if (mainFrame)
+		mainFrame->PostStatusEvent(type, std::move(json));
+}
+
+std::string FinderTarget::PrintJSON(cJSON* root)
+{
+	std::string json;
+	if (char* printed = cJSON_PrintUnformatted(root))
+	{
+		json = printed;
+		cJSON_free(printed);
+	}
+
+	cJSON_Delete(root);
+	return json;
+}
+
+void FinderTarget::AddStringArray(cJSON* object, const char* field, const std::vector<std::string>& values)
+{
+	cJSON* array(cJSON_AddArrayToObject(object, field));
+	for (const auto& v : values)
+		cJSON_AddItemToArray(array, cJSON_CreateString(v.c_str()));
+}
+
+double FinderTarget::ToUnixTime(const std::chrono::system_clock::time_point& t)
+{
+	return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+void FinderTarget::ReportAppointments(const std::string& appointmentInfo)
+{
+	reportedDuringCheck = true;
+	SendLogMessage("Found appointment!");
+	OnAppointmentsAvailable(appointmentInfo);
+}
+
+// Same as JSONInterface::DoCURLGet, but takes a narrow URL and runs on the shared fetch engine
+FinderTarget::GetAwaiter FinderTarget::Get(const std::string& requestURL, std::string& response,
+	CURLModificationFunction curlModFunction, const ModificationData* modificationData)
+{
+	return GetAwaiter(*this, requestURL, response, curlModFunction, modificationData, FetchEngine::Priority::Routine);
+}
+
+FinderTarget::GetAwaiter FinderTarget::GetShared(const std::string& requestURL, ResponseBufferPool::Buffer& buffer, SharedResponse& response,
+	CURLModificationFunction curlModFunction, const ModificationData* modificationData)
+{
+	return GetAwaiter(*this, requestURL, buffer, response, curlModFunction, modificationData);
+}
+
+FinderTarget::GetAwaiter FinderTarget::Confirm(const std::string& requestURL, std::string& response,
+	CURLModificationFunction curlModFunction, const ModificationData* modificationData)
+{
+	return GetAwaiter(*this, requestURL, response, curlModFunction, modificationData, FetchEngine::Priority::Confirmation);
+}
+
+bool FinderTarget::GetAwaiter::await_suspend(std::coroutine_handle<> awaiting)
+{
+	// Nothing may touch the transfers after Join() or Submit(); the engine can complete them right away
+	transfer.continuation = awaiting;
+	hedge.continuation = awaiting;
+
+	auto& target(transfer.target);
+	if (target.simulation)
+	{
+		const auto response(std::make_shared<const RequestCoalescer::Response>(target.simulation->Respond(transfer.url)));
+		transfer.Accept(response);
+		if (!sharedResponse)
+			*transfer.sink.response = response->body;
+		++target.requestCount;
+		target.decodedBytes += response->body.size();
+		return false;// Don't suspend
+	}
+
+	// Once detached, the engine may already be gone
+	std::lock_guard<std::mutex> lock(target.sinkMutex);
+	if (!target.fetchEngine)
+	{
+		transfer.result = CURLE_ABORTED_BY_CALLBACK;
+		transfer.completed = true;
+		return false;// Don't suspend
+	}
+
+	if (sharedResponse)
+	{
+		auto& coalescer(target.fetchEngine->GetCoalescer());
+		SharedResponse recent;
+		switch (coalescer.Join(transfer.url, transfer.GetOptionsTag(), &transfer, recent))
+		{
+		case RequestCoalescer::Role::Fresh:
+			transfer.Accept(recent);
+			transfer.shared = true;
+			++target.sharedCount;
+			return false;// Don't suspend
+
+		case RequestCoalescer::Role::Follower:
+			return true;
+
+		case RequestCoalescer::Role::Leader:
+			transfer.coalescer = &coalescer;
+			hedge.coalescer = &coalescer;
+			break;
+		}
+	}
+
+	// A warm-up only has to open its connection, so there's nothing to hedge or time
+	if (priority == FetchEngine::Priority::WarmUp)
+		target.fetchEngine->Submit(&transfer, std::string_view(), nullptr, priority, egress);
+	else
+		target.fetchEngine->Submit(&transfer, GetEndpoint(transfer.url), &hedge, priority);
+	return true;
+}
+
+bool FinderTarget::GetAwaiter::await_resume()
+{
+	// What a warm-up got back doesn't matter, but the protocol decides how many connections the next one opens
+	if (priority == FetchEngine::Priority::WarmUp)
+	{
+		if (transfer.result != CURLE_OK)
+			return false;
+
+		transfer.target.multiplexedOrigins[std::string(GetOrigin(transfer.url))] = transfer.httpVersion >= CURL_HTTP_VERSION_2_0;
+		return true;
+	}
+
+	auto& finished(hedge.completed ? hedge : transfer);
+	if (sharedResponse)
+		*sharedResponse = std::move(finished.sharedResponse);
+	else if (hedge.completed)
+		transfer.sink.response->swap(hedgeResponse);
+
+	return finished.target.FinishTransfer(finished);
+}
+
+bool FinderTarget::FinishTransfer(const GetTransfer& transfer)
+{
+	if (transfer.result == CURLE_ABORTED_BY_CALLBACK)
+	{
+		if (stop)
+			return false;// Stopping cancels everything, including requests waiting on another target
+
+		if (transfer.shared)
+			SendLogMessage(name + " shared request was abandoned by the target that sent it");
+		else
+			SendLogMessage(name + " check took longer than " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(maxCheckDuration).count()) + " sec; abandoned");
+		return false;
+	}
+
+	if (transfer.result == CURLE_OPERATION_TIMEDOUT)
+	{
+		SendLogMessage(name + " request timed out");
+		return false;
+	}
+
+	if (transfer.result == CURLE_FILESIZE_EXCEEDED || (transfer.result == CURLE_WRITE_ERROR && transfer.sink.limitExceeded))
+	{
+		SendLogMessage(name + " response exceeded " + std::to_string(transfer.sink.maxSize) + " bytes; aborted");
+		return false;
+	}
+
+	if (CURLUtilities::CURLCallHasError(transfer.result, _T("Failed issuing https GET")))
+		return false;
+
+	if (transfer.responseCode == 401 || transfer.responseCode == 403)
+	{
+		sessionRejected = true;
+		SendLogMessage(name + " session rejected (HTTP " + std::to_string(transfer.responseCode) + "); will refresh");
+		return false;
+	}
+
+	// Error pages aren't worth parsing
+	if (transfer.responseCode >= 400)
+	{
+		SendLogMessage(name + " request failed (HTTP " + std::to_string(transfer.responseCode) + ")");
+		const auto endpoint(GetEndpoint(transfer.url));
+		ReportEndpointTransition(endpoint, endpointHealth.RecordHTTPError(endpoint, Now()));
+		return false;
+	}
+
+	return true;
+}
+
+void FinderTarget::PublishAvailability(const SubscriptionEngine::Location& location, const bool& available)
+{
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	if (availabilityTable)
+		availabilityTable->Update(name, location.description.empty() ? location.id : location.description, available, Now());
+	if (subscriptionEngine)
+		subscriptionEngine->Update(location, available);
+}
+
+void FinderTarget::RecordParsed(const std::string& requestURL, const unsigned int& recordCount, const unsigned int& skippedCount)
+{
+	const auto endpoint(GetEndpoint(requestURL));
+	const double goodFraction(recordCount > 0 ? 1.0 - static_cast<double>(skippedCount) / recordCount : 1.0);
+	ReportEndpointTransition(endpoint, endpointHealth.RecordParsed(endpoint, goodFraction, Now()));
+}
+
+void FinderTarget::RecordParseFailure(const std::string& requestURL)
+{
+	const auto endpoint(GetEndpoint(requestURL));
+	ReportEndpointTransition(endpoint, endpointHealth.RecordParseFailure(endpoint, Now()));
+}
+
+void FinderTarget::ReportEndpointTransition(const std::string_view& endpoint, const EndpointHealth::Transition& transition)
+{
+	if (transition == EndpointHealth::Transition::None)
+		return;
+
+	const bool demoted(transition == EndpointHealth::Transition::Demoted);
+	if (demoted)
+		SendLogMessage(name + " keeps getting bad responses from " + std::string(endpoint) + "; only probing it occasionally until it recovers");
+	else
+		SendLogMessage(name + " is getting good responses from " + std::string(endpoint) + " again");
+
+	cJSON* data(cJSON_CreateObject());
+	cJSON_AddStringToObject(data, "target", name.c_str());
+	cJSON_AddStringToObject(data, "endpoint", std::string(endpoint).c_str());
+	cJSON_AddBoolToObject(data, "demoted", demoted);
+	PostStatusEvent("endpoint", data);
+}
+
+bool FinderTarget::SessionNeedsRefresh() const
+{
+	if (!hasSession || sessionRejected)
+		return true;
+
+	const auto now(Now());
+	return now + cookieExpiryMargin > sessionExpiryTime || now > sessionRefreshedTime + maxSessionAge;
+}
+
+void FinderTarget::SessionRefreshed()
+{
+	hasSession = true;
+	sessionRejected = false;
+	sessionRefreshedTime = Now();
+	sessionExpiryTime = GetEarliestCookieExpiry();
+}
+
+// Time the first persistent cookie expires (or far in the future if there are none - maxSessionAge still applies)
+std::chrono::system_clock::time_point FinderTarget::GetEarliestCookieExpiry()
+{
+	auto earliest(std::chrono::system_clock::time_point::max());
+	if (!cookieShare)
+		return earliest;
+
+	CURL* curl(curl_easy_init());
+	if (!curl)
+		return earliest;
+
+	curl_easy_setopt(curl, CURLOPT_SHARE, cookieShare);
+	curl_easy_setopt(curl, CURLOPT_COOKIEFILE, "");
+
+	struct curl_slist* cookies(nullptr);
+	if (curl_easy_getinfo(curl, CURLINFO_COOKIELIST, &cookies) == CURLE_OK)
+	{
+		// Netscape format:  domain, tail match, path, secure, expires, name, value (tab separated)
+		for (auto c = cookies; c; c = c->next)
+		{
+			std::istringstream ss(c->data);
+			std::vector<std::string> fields;
+			std::string field;
+			while (std::getline(ss, field, '\t'))
+				fields.push_back(field);
+
+			if (fields.size() < 5)
+				continue;
+
+			const long long expires(std::strtoll(fields[4].c_str(), nullptr, 10));
+			if (expires > 0)// Zero means the cookie lasts for the session
+				earliest = std::min(earliest, std::chrono::system_clock::time_point(std::chrono::seconds(expires)));
+		}
+		curl_slist_free_all(cookies);
+	}
+
+	curl_easy_cleanup(curl);
+	return earliest;
+}
+
+FinderTarget::GetTransfer::GetTransfer(FinderTarget& target, const std::string& url, std::string& response,
+	CURLModificationFunction curlModFunction, const ModificationData* modificationData) : target(target), url(url),
+	curlModFunction(curlModFunction), modificationData(modificationData)
+{
+	sink.response = &response;
+	sink.maxSize = target.maxResponseSize;
+}
+
+bool FinderTarget::GetTransfer::Configure(CURL* curl)
+{
+	sink.response->clear();
+	if (target.stop)
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_URL, url.c_str()), _T("Failed to set URL")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_USERAGENT, userAgent.c_str()), _T("Failed to set user agent")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback), _T("Failed to set write callback")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink), _T("Failed to set write data")))
+		return false;
+
+	// Empty string lets curl offer every encoding it was built with (gzip, deflate, br)
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""), _T("Failed to enable compression")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, static_cast<long>(requestTimeout.count())), _T("Failed to set timeout")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(connectTimeout.count())), _T("Failed to set connect timeout")))
+		return false;
+
+	// Lets a stopped target or an overdue check abandon the transfer between timeouts
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, ProgressCallback), _T("Failed to set progress callback")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this), _T("Failed to set progress data")))
+		return false;
+
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L), _T("Failed to enable progress callback")))
+		return false;
+
+	// Catches oversized responses up front when the server reports Content-Length; WriteCallback catches the rest
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(sink.maxSize)), _T("Failed to set maximum response size")))
+		return false;
+
+	if (target.cookieShare)
+	{
+		if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_SHARE, target.cookieShare), _T("Failed to set cookie share")))
+			return false;
+
+		// Only read the file once; after that the shared store is newer than what's on disk (empty string just enables cookies)
+		const char* fileToLoad(target.cookiesLoaded ? "" : target.cookieFile.c_str());
+		if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_COOKIEFILE, fileToLoad), _T("Failed to load the cookie file")))
+			return false;
+		target.cookiesLoaded = true;
+
+		if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback), _T("Failed to set header callback")))
+			return false;
+
+		if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_HEADERDATA, &target), _T("Failed to set header data")))
+			return false;
+	}
+
+	if (curlModFunction && !curlModFunction(curl, modificationData))
+		return false;
+
+	return true;
+}
+
+void FinderTarget::GetTransfer::Complete(CURL* curl, const CURLcode& result)
+{
+	if (curl)
+	{
+		RecordTransferSize(curl);
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &responseCode);
+		curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &httpVersion);
+	}
+
+	this->result = result;
+	completed = true;
+
+	// The body moves into the shared response, which our own check reads too, so nobody copies it
+	if (coalescer)
+		sharedResponse = coalescer->Finish(url, GetOptionsTag(), result, responseCode,
+			pooledBuffer ? pooledBuffer->Take() : std::move(*sink.response));
+
+	target.resumeQueue.Post(continuation);// Must be last - the check thread may destroy this transfer as soon as it's posted
+}
+
+void FinderTarget::GetTransfer::Deliver(const SharedResponse& response)
+{
+	Accept(response);
+	shared = true;
+	++target.sharedCount;
+	target.resumeQueue.Post(continuation);// Must be last - the check thread may destroy this transfer as soon as it's posted
+}
+
+void FinderTarget::GetTransfer::Accept(const SharedResponse& response)
+{
+	sharedResponse = response;
+	result = response->result;
+	responseCode = response->responseCode;
+	completed = true;
+}
+
+void FinderTarget::GetTransfer::Cancelled(CURL* curl)
+{
+	RecordTransferSize(curl);
+}
+
+int FinderTarget::GetTransfer::ProgressCallback(void* userData, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+	const auto transfer(reinterpret_cast<const GetTransfer*>(userData));
+	if (transfer->target.stop || std::chrono::steady_clock::now() > transfer->target.checkDeadline.load())
+		return 1;// Anything other than zero aborts the transfer
+	return 0;
+}
+
+void FinderTarget::GetTransfer::RecordTransferSize(CURL* curl)
+{
+	curl_off_t bodyBytes(0);
+	long headerBytes(0);
+	curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &bodyBytes);
+	curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &headerBytes);
+	++target.requestCount;
+	target.wireBytes += static_cast<unsigned long long>(bodyBytes) + static_cast<unsigned long long>(headerBytes);
+	target.decodedBytes += sink.response->size();
+}
+
+void FinderTarget::LockCookieShare(CURL*, curl_lock_data, curl_lock_access, void* userData)
+{
+	reinterpret_cast<FinderTarget*>(userData)->cookieShareMutex.lock();
+}
+
+void FinderTarget::UnlockCookieShare(CURL*, curl_lock_data, void* userData)
+{
+	reinterpret_cast<FinderTarget*>(userData)->cookieShareMutex.unlock();
+}
+
+// The jar is written when a handle that has one is cleaned up, so use a temporary handle attached to the share
+void FinderTarget::SaveCookies()
+{
+	CURL* curl(curl_easy_init());
+	if (!curl)
+		return;
+
+	curl_easy_setopt(curl, CURLOPT_SHARE, cookieShare);
+	curl_easy_setopt(curl, CURLOPT_COOKIEJAR, cookieFile.c_str());
+	curl_easy_cleanup(curl);
+}
+
+size_t FinderTarget::WriteCallback(char* ptr, size_t size, size_t nmemb, void* userData)
+{
+	const size_t totalSize(size * nmemb);
+	auto sink(reinterpret_cast<ResponseSink*>(userData));
+	if (sink->response->size() + totalSize > sink->maxSize)
+	{
+		sink->limitExceeded = true;
+		return 0;// Anything other than totalSize aborts the transfer
+	}
+
+	sink->response->append(ptr, totalSize);
+	return totalSize;
+}
+
+size_t FinderTarget::HeaderCallback(char* buffer, size_t size, size_t nitems, void* userData)
+{
+	const size_t totalSize(size * nitems);
+	const std::string_view setCookie("set-cookie:");
+	if (totalSize >= setCookie.size() && std::equal(setCookie.begin(), setCookie.end(), buffer,
+		[](const char& a, const char& b) { return a == std::tolower(static_cast<unsigned char>(b)); }))
+		reinterpret_cast<FinderTarget*>(userData)->cookiesChanged = true;
+
+	return totalSize;
+}
+
+FinderTarget::TransferStatistics FinderTarget::GetTransferStatistics() const
+{
+	TransferStatistics statistics;
+	statistics.requestCount = requestCount;
+	statistics.wireBytes = wireBytes;
+	statistics.decodedBytes = decodedBytes;
+	statistics.sharedCount = sharedCount;
+	return statistics;
+}
+
+std::string FinderTarget::GetTransferSummary() const
+{
+	const auto statistics(GetTransferStatistics());
+	std::ostringstream ss;
+	ss << name << ":  " << statistics.requestCount << " requests, "
+		<< std::fixed << std::setprecision(1) << statistics.wireBytes / 1024.0 << " kB received ("
+		<< statistics.decodedBytes / 1024.0 << " kB decoded); " << statistics.sharedCount << " responses shared";
+	return ss.str();
+}
+
 UString::String FinderTarget::ReplaceAll(const UString::String&s, const UString::String& match, const UString::String& replaceWith)
 {
 	UString::String out(s);
@@ -54,38 +704,242 @@ UString::String FinderTarget::ReplaceAll(const UString::String&s, const UString:
 	return out;
 }
 
+// Request chains within a check don't hold a thread:  each fetch suspends its coroutine until the response
+// arrives, so a check can have any number of chains in flight (Rite Aid runs one per store).  Only this
+// outer loop has a thread, which sleeps between checks and runs the check's coroutines during one (the
+// engine posts each completed fetch back here through resumeQueue).  That costs one thread per target, and
+// it's what keeps parsing and publishing off the engine thread, lets the watchdog abandon a wedged target
+// without stalling the others, and lets a simulated clock advance while the target waits.
 void FinderTarget::CheckThreadEntry()
 {
-	SendLogMessage("Beginning " + UString::ToNarrowString(name) + " search...");
-	auto fastCheckEndTime(std::chrono::system_clock::now());
-	while (!stop)
+	SendLogMessage("Beginning " + name + " search...");
+
+	// Wait for our phase before the first check
+	scheduleStart = Now() + std::chrono::duration_cast<std::chrono::system_clock::duration>(checkPeriod * phase);
+	nextCheckDue = scheduleStart;
 	{
-		state = State::NormalCheck;
+		std::unique_lock<std::mutex> lock(mutex);
+		clock->WaitUntil(lock, stopCondition, scheduleStart, [this]() { return stop.load(); });
+	}
 
+	unsigned int followUpChecksRemaining(0);
+	while (!stop)
+	{
+		// Checks confirm hits themselves before returning true, so anything reported here has been seen twice
+		reportedDuringCheck = false;
+		alreadyReported = false;
+		const auto startTime(std::chrono::steady_clock::now());
+		checkStartTime = startTime;
+		checking = true;
+		checkDeadline = startTime + maxCheckDuration;
 		std::string message;
-		if (AppointmentsAvailable(message))
+		const bool found(resumeQueue.Run(AppointmentsAvailable(message)));
+		RecordCheckDuration(std::chrono::steady_clock::now() - startTime);
+		checking = false;
+		if (found && !alreadyReported)
+		{
+			if (!reportedDuringCheck)
+			{
+				SendLogMessage("Found appointment!");
+				OnAppointmentsAvailable(message);
+			}
+
+			if (DoFoundAppointmentStateChange() == State::FollowUpCheck)
+				followUpChecksRemaining = timingPolicy.followUpCheckCount;
+		}
+		else if (followUpChecksRemaining > 0)
+			--followUpChecksRemaining;
+
+		state = followUpChecksRemaining > 0 ? State::FollowUpCheck : State::NormalCheck;
+		if (found != lastCheckFound)
 		{
-			SendLogMessage("Found appointment!");
-			OnAppointmentsAvailable(message);
-			state = DoFoundAppointmentStateChange();
+			cJSON* data(cJSON_CreateObject());
+			cJSON_AddStringToObject(data, "target", name.c_str());
+			cJSON_AddNumberToObject(data, "time", ToUnixTime(Now()));
+			cJSON_AddBoolToObject(data, "found", found);
+			PostStatusEvent("transition", data);
 		}
 
+		lastCheckTime = Now();
+		lastCheckFound = found;
+		if (found && !message.empty())
+			lastFoundMessage = message;
+
+		CaptureState();
+		PublishStatus();
 		Sleep();
 	}
+
+	finished = true;
+}
+
+void FinderTarget::RecordCheckDuration(const std::chrono::steady_clock::duration& duration)
+{
+	std::lock_guard<std::mutex> lock(durationMutex);
+	recentCheckDurations[checkCount % recentCheckDurations.size()] = duration;
+	++checkCount;
+}
+
+FinderTarget::Health FinderTarget::GetHealth() const
+{
+	Health health;
+	health.checking = checking;
+	health.checkElapsed = health.checking ? std::chrono::steady_clock::now() - checkStartTime.load() : std::chrono::steady_clock::duration::zero();
+
+	const auto now(Now());
+	const auto due(nextCheckDue.load());
+	health.scheduleLag = !health.checking && now > due ? now - due : std::chrono::system_clock::duration::zero();
+
+	std::lock_guard<std::mutex> lock(durationMutex);
+	health.checkCount = checkCount;
+	const size_t count(std::min<size_t>(health.checkCount, recentCheckDurations.size()));
+	if (count == 0)
+	{
+		health.p99CheckDuration = std::chrono::steady_clock::duration::zero();
+		return health;
+	}
+
+	auto sorted(recentCheckDurations);
+	std::sort(sorted.begin(), sorted.begin() + count);
+	health.p99CheckDuration = sorted[count * 99 / 100];
+	return health;
 }
 
 void FinderTarget::Sleep()
 {
+	// Stop() may have been called during the check, before we started waiting
+	const auto isStopped([this]() { return stop.load(); });
+	const auto now(Now());
+	const auto wakeTime(state == State::FollowUpCheck ? now + GetScheduledPeriod() / timingPolicy.followUpPeriodDivisor : GetNextScheduledCheck(now));
+	nextCheckDue = wakeTime;
+
 	std::unique_lock<std::mutex> lock(mutex);
-	if (state == State::NormalCheck)
-		stopCondition.wait_for(lock, checkPeriod);
-	else if (state == State::FoundAppointmentDelay)
-		stopCondition.wait_for(lock, checkPeriod * 4);
+
+	// Demoted targets mostly skip their checks, so there's nothing to warm up for
+	const auto warmUpTime(wakeTime - warmUpLead);
+	if (!simulation && warmUpTime > now && !IsDemoted())
+	{
+		clock->WaitUntil(lock, stopCondition, warmUpTime, isStopped);
+		if (stop)
+			return;
+
+		// Stop() needs the lock; a warm-up that isn't done by the time the check is due is abandoned
+		const auto upcoming(GetUpcomingRequests(wakeTime));
+		if (!upcoming.url.empty())
+		{
+			lock.unlock();
+			checkDeadline = std::chrono::steady_clock::now() + warmUpLead;
+			resumeQueue.Run(WarmUp(upcoming));
+			lock.lock();
+		}
+	}
+
+	clock->WaitUntil(lock, stopCondition, wakeTime, isStopped);
+}
+
+// Each request needs a connection of its own unless the host multiplexes, and cURL won't open more than
+// FetchEngine::maxConnectionsPerHost to one host per egress.  Until a host has answered, assume it doesn't
+// multiplex (the spare connections only cost a handshake each, once).
+Task<bool> FinderTarget::WarmUp(const UpcomingRequests& upcoming)
+{
+	std::vector<size_t> egresses;
+	{
+		std::lock_guard<std::mutex> lock(sinkMutex);
+		if (!fetchEngine)
+			co_return false;
+		egresses = fetchEngine->GetUpcomingEgresses(upcoming.burstSize);
+	}
+
+	const auto multiplexed(multiplexedOrigins.find(GetOrigin(upcoming.url)));
+	const unsigned int maxConnections(multiplexed != multiplexedOrigins.end() && multiplexed->second ? 1 : FetchEngine::maxConnectionsPerHost);
+
+	std::map<size_t, unsigned int> connectionCounts;// By egress
+	for (const auto& egress : egresses)
+	{
+		auto& count(connectionCounts[egress]);
+		count = std::min(count + 1, maxConnections);
+	}
+
+	unsigned int totalConnections(0);
+	for (const auto& count : connectionCounts)
+		totalConnections += count.second;
+
+	std::vector<std::string> responses(totalConnections);
+	std::vector<Task<bool>> requests;
+	for (const auto& count : connectionCounts)
+	{
+		for (unsigned int i = 0; i < count.second; ++i)
+			requests.push_back(WarmUpConnection(upcoming, count.first, responses[requests.size()]));
+	}
+
+	const auto results(co_await WhenAll(std::move(requests)));
+	co_return std::find(results.begin(), results.end(), false) == results.end();
+}
+
+Task<bool> FinderTarget::WarmUpConnection(const UpcomingRequests& upcoming, const size_t& egress, std::string& response)
+{
+	co_return co_await GetAwaiter(*this, upcoming.url, response, upcoming.curlModFunction, upcoming.modificationData, FetchEngine::Priority::WarmUp, egress);
+}
+
+// scheme://host[:port], which is what cURL matches connections on (along with the egress)
+std::string_view FinderTarget::GetOrigin(const std::string& requestURL)
+{
+	const auto schemeEnd(requestURL.find("://"));
+	if (schemeEnd == std::string::npos)
+		return std::string_view();
+
+	return std::string_view(requestURL).substr(0, requestURL.find_first_of("/?#", schemeEnd + 3));
+}
+
+std::chrono::system_clock::duration FinderTarget::GetScheduledPeriod() const
+{
+	return std::chrono::duration_cast<std::chrono::system_clock::duration>(checkPeriod * periodScale.load());
+}
+
+// First slot on the grid that's still ahead of us (a check that overran its period skips the slots it missed)
+std::chrono::system_clock::time_point FinderTarget::GetNextScheduledCheck(const std::chrono::system_clock::time_point& now) const
+{
+	const auto period(GetScheduledPeriod());
+	long long slot(now > scheduleStart ? static_cast<long long>((now - scheduleStart) / period) + 1 : 1);
+	auto next(scheduleStart + period * slot + GetJitter(slot, period));
+	while (next <= now)
+	{
+		++slot;
+		next = scheduleStart + period * slot + GetJitter(slot, period);
+	}
+
+	return next;
+}
+
+std::chrono::system_clock::duration FinderTarget::GetJitter(const long long& slot, const std::chrono::system_clock::duration& period) const
+{
+	// FNV-1a of the name, mixed with the slot number (splitmix64 finalizer)
+	unsigned long long h(14695981039346656037ULL);
+	for (const auto& c : name)
+	{
+		h ^= static_cast<unsigned char>(c);
+		h *= 1099511628211ULL;
+	}
+
+	h ^= static_cast<unsigned long long>(slot) + 0x9e3779b97f4a7c15ULL;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+
+	const double unit(static_cast<double>(h >> 11) / static_cast<double>(1ULL << 53) * 2.0 - 1.0);// [-1, 1)
+	return std::chrono::duration_cast<std::chrono::system_clock::duration>(period * (unit * jitterFraction));
 }
 
 void FinderTarget::Stop()
 {
-	std::lock_guard<std::mutex> lock(mutex);
-	stop = true;
-	stopCondition.notify_all();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		stopCondition.notify_all();
+	}
+
+	// Don't wait for transfers in progress; the check thread can only exit once they've completed
+	std::lock_guard<std::mutex> lock(sinkMutex);
+	if (fetchEngine)
+		fetchEngine->CancelAbandoned();
 }
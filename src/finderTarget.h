@@ -7,6 +7,14 @@
 #define FINDER_TARGET_H_
 
 // Local headers
+#include "fetchEngine.h"
+#include "responseBufferPool.h"
+#include "snapshot.h"
+#include "task.h"
+#include "clock.h"
+#include "endpointHealth.h"
+#include "availabilityTable.h"
+#include "subscriptionEngine.h"
 #include "utilities/uString.h"
 #include "email/jsonInterface.h"
 #include "email/emailSender.h"
@@ -16,6 +24,9 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <array>
+#include <map>
+#include <functional>
 
 // for cURL
 typedef void CURL;
@@ -26,41 +37,382 @@ class MainFrame;
 class FinderTarget : public JSONInterface
 {
 public:
-	FinderTarget(const UString::String& url, MainFrame* mainFrame, const unsigned int& checkPeriodSeconds, const UString::String& name);
+	// fetchEngine may only be null for a target that will be given a Simulation (see SetSimulation())
+	FinderTarget(const std::string& url, MainFrame* mainFrame, FetchEngine* fetchEngine, const unsigned int& checkPeriodSeconds,
+		const std::string& name, const std::string& cookieFile = std::string());
 	virtual ~FinderTarget();
 
 	void BeginCheckLoop();
 	void Stop();
+	void Join();
+
+	const std::string& GetName() const { return name; }
+	std::string GetHost() const;
+
+	// Where this target's checks fall within its period, as a fraction of the period; call before BeginCheckLoop()
+	void SetSchedulePhase(const double& fraction) { phase = fraction; }
+
+	// Check timing after a hit; call before BeginCheckLoop()
+	struct TimingPolicy
+	{
+		unsigned int followUpCheckCount = 3;// Checks at the shorter period after a hit
+		unsigned int followUpPeriodDivisor = 4;
+		unsigned int postponePeriods = 10;// Periods to skip a location after reporting it (for targets that do)
+	};
+
+	void SetTimingPolicy(const TimingPolicy& policy) { timingPolicy = policy; }
+
+	// Stands in for the network, the UI and the clock, so checks can be replayed against a recorded timeline
+	class Simulation
+	{
+	public:
+		virtual ~Simulation() = default;
+
+		virtual Clock& GetClock() = 0;
+
+		// Called on the check thread in place of a network request
+		virtual RequestCoalescer::Response Respond(const std::string& url) = 0;
+		virtual void OnAppointmentsAvailable(const std::string& appointmentInfo) = 0;
+	};
+
+	// Call before BeginCheckLoop(); construct simulated targets without a MainFrame.  Cookies aren't saved.
+	void SetSimulation(Simulation& s) { simulation = &s; clock = &s.GetClock(); }
+
+	// Call before BeginCheckLoop(); state that doesn't fit this target's configuration is ignored
+	void RestoreState(const std::string& snapshot);
+
+	// State as of the end of the most recent check
+	std::string GetStateSnapshot() const;
+
+	// Responses larger than this (after decoding) are aborted mid-transfer
+	void SetMaxResponseSize(const size_t& bytes) { maxResponseSize = bytes; }
+	static const size_t defaultMaxResponseSize;
+
+	struct TransferStatistics
+	{
+		unsigned long long requestCount;
+		unsigned long long wireBytes;// Headers and (possibly compressed) body, as received
+		unsigned long long decodedBytes;// Body after content decoding
+		unsigned long long sharedCount;// Responses taken from another request for the same thing (not included above)
+	};
+
+	TransferStatistics GetTransferStatistics() const;
+	std::string GetTransferSummary() const;
+
+	// Heartbeat for the watchdog; safe to call from any thread
+	struct Health
+	{
+		bool checking;
+		std::chrono::steady_clock::duration checkElapsed;// Of the check in progress
+		std::chrono::system_clock::duration scheduleLag;// How long the next check is overdue (zero if it isn't)
+		unsigned long long checkCount;
+		std::chrono::steady_clock::duration p99CheckDuration;// Over recent checks; zero until there are any
+	};
+
+	Health GetHealth() const;
+	bool HasFinished() const { return finished; }// Check loop has exited (after Stop())
+
+	double GetSchedulePhase() const { return phase; }
+	std::chrono::system_clock::duration GetCheckPeriod() const { return checkPeriod; }
+
+	// Transfers still running this long after a check started are abandoned
+	static const std::chrono::steady_clock::duration maxCheckDuration;
+
+	// True while the endpoint this target's checks depend on is demoted to occasional probes (see EndpointHealth)
+	virtual bool IsDemoted() const { return false; }
+
+	// Scales the time between checks; lets healthy targets use the requests demoted targets aren't making
+	void SetPeriodScale(const double& scale) { periodScale = scale; }
+
+	// Call before BeginCheckLoop(); per-location results are published to these (if set) as they're checked
+	void SetAvailabilityTable(AvailabilityTable* table) { availabilityTable = table; }
+	void SetSubscriptionEngine(SubscriptionEngine* engine) { subscriptionEngine = engine; }
+
+	// For a replaced target:  cuts it off from everything it shares with its replacement (the main frame, the
+	// availability table, subscriptions and the cookie file) and from the fetch engine, which may be destroyed while
+	// a stuck target is still running.  Once this returns, none of them is touched again; later requests fail as aborted.
+	void Detach();
 
 protected:
-	const UString::String url;
-	const UString::String name;
+	// URLs, locations and messages are kept as narrow (UTF-8) strings so checks don't need to convert
+	const std::string url;
+	const std::string name;
 	MainFrame* mainFrame;
+	mutable std::mutex sinkMutex;// Held while mainFrame, the fetch engine (or another sink) is in use, so Detach() can't return mid-call
 
 	void SendLogMessage(const std::string& s) const;
 
+	// Notifies right away instead of waiting for the check to finish; the check's own result then doesn't notify again
+	void ReportAppointments(const std::string& appointmentInfo);
+
+	// For a check that finds availability an earlier check already reported:  the check still returns true (so the
+	// status shows what's really there), but doesn't notify or start follow-up checks again
+	void AlreadyReported() { alreadyReported = true; }
+
+	// For the shared availability table and subscribers; location.target must be this target's name
+	void PublishAvailability(const SubscriptionEngine::Location& location, const bool& available);
+
+	// Reused between checks and reserved to the endpoint's usual response size; hold it until parsing is done
+	ResponseBufferPool::Buffer GetResponseBuffer(const std::string& requestURL) { return responseBuffers.Acquire(GetEndpoint(requestURL)); }
+
+	// Call once per check before requesting an endpoint; demoted endpoints are skipped except for the occasional probe
+	EndpointHealth::Access GetEndpointAccess(const std::string& requestURL) { return endpointHealth.GetAccess(GetEndpoint(requestURL), Now()); }
+	bool IsEndpointDemoted(const std::string& requestURL) const { return endpointHealth.IsDemoted(GetEndpoint(requestURL)); }
+
+	// HTTP errors are recorded as responses arrive; derived classes record how parsing went
+	void RecordParsed(const std::string& requestURL, const unsigned int& recordCount, const unsigned int& skippedCount);
+	void RecordParseFailure(const std::string& requestURL);
+
+	// Base pages are only fetched to keep session cookies current; these decide when that's actually needed
+	bool SessionNeedsRefresh() const;
+	void SessionRefreshed();
+
+	class GetAwaiter;
+
+	// Use as "if (!co_await Get(...))" from within a check; the coroutine resumes on the check thread once the response has arrived
+	GetAwaiter Get(const std::string& requestURL, std::string& response,
+		CURLModificationFunction curlModFunction = nullptr, const ModificationData* modificationData = nullptr);
+
+	// Same as Get(), but identical requests (same URL and curlModFunction) from any target share one transfer while
+	// it's in flight, and a successful response is reused for a few seconds.  Only use where the response doesn't
+	// depend on this target's session, and where modificationData is the same for every target making the request.
+	// The body is read from response, which everyone sharing it reads; buffer is only written while the request is
+	// in flight (and is empty afterward).
+	typedef std::shared_ptr<const RequestCoalescer::Response> SharedResponse;
+	GetAwaiter GetShared(const std::string& requestURL, ResponseBufferPool::Buffer& buffer, SharedResponse& response,
+		CURLModificationFunction curlModFunction = nullptr, const ModificationData* modificationData = nullptr);
+
+	// Same as Get(), but goes ahead of any routine requests still waiting to start; use to double-check a hit before alerting
+	GetAwaiter Confirm(const std::string& requestURL, std::string& response,
+		CURLModificationFunction curlModFunction = nullptr, const ModificationData* modificationData = nullptr);
+
+	using JSONInterface::ReadJSON;
+	static bool ReadJSON(cJSON* root, const char* field, std::string& value);
+	static bool ReadJSON(cJSON* root, const char* field, unsigned int& value);
+	static bool ReadJSON(cJSON* root, const char* field, bool& value);
+	static bool ReadJSON(cJSON* root, const char* field, double& value);
+
 	std::atomic<bool> stop = false;
 	std::condition_variable stopCondition;
 	std::mutex mutex;
 
-	virtual bool AppointmentsAvailable(std::string& message) = 0;
+	// Checks are coroutines so that multi-step request chains don't need a thread of their own
+	virtual Task<bool> AppointmentsAvailable(std::string& message) = 0;
+
+	// Derived classes add their own state after calling these; only called while no check is running
+	virtual void SaveState(SnapshotWriter& writer) const;
+	virtual bool LoadState(SnapshotReader& reader);
+
+	// What the next check (at checkTime) will request, and how many of those requests it sends at once, so that many
+	// connections can be opened beforehand (leave url empty if the check won't send anything).  Only called while no
+	// check is running.
+	struct UpcomingRequests
+	{
+		std::string url;
+		unsigned int burstSize = 1;
+		CURLModificationFunction curlModFunction = nullptr;
+		const ModificationData* modificationData = nullptr;
+	};
+
+	virtual UpcomingRequests GetUpcomingRequests(const std::chrono::system_clock::time_point&) const { return UpcomingRequests{ url }; }
+
+	// Derived classes add their own fields to the status served by the status API; only called while no check is running
+	virtual void AddStatus(cJSON*) const {}
+	static double ToUnixTime(const std::chrono::system_clock::time_point& t);
+	static void AddStringArray(cJSON* object, const char* field, const std::vector<std::string>& values);
 
 	enum class State
 	{
 		NormalCheck,
-		FoundAppointmentDelay
+		FollowUpCheck// Shortly after a hit, check more often to catch changes (and re-openings) quickly
 	};
 
 	State state = State::NormalCheck;
 
-	virtual State DoFoundAppointmentStateChange() const { return State::FoundAppointmentDelay; }
+	virtual State DoFoundAppointmentStateChange() const { return State::FollowUpCheck; }
+
+	TimingPolicy timingPolicy;
 
 	const std::chrono::system_clock::duration checkPeriod;
 
+	// Use instead of std::chrono::system_clock::now() for anything that affects when or what to check
+	std::chrono::system_clock::time_point Now() const { return clock->Now(); }
+
+private:
+	static const std::string userAgent;
+
+	// A stuck server can't hold up a check (or shutdown) for longer than these
+	static const std::chrono::milliseconds requestTimeout;
+	static const std::chrono::milliseconds connectTimeout;
+	std::atomic<std::chrono::steady_clock::time_point> checkDeadline;
+
+	FetchEngine* fetchEngine;// Null for simulated targets and once detached; guarded by sinkMutex
+	ResponseBufferPool responseBuffers;
+	ResumeQueue resumeQueue;// Completed fetches hand their coroutines back to the check thread through this
+
+	Clock* clock = &Clock::System();
+	Simulation* simulation = nullptr;
+
+	EndpointHealth endpointHealth;
+	AvailabilityTable* availabilityTable = nullptr;
+	SubscriptionEngine* subscriptionEngine = nullptr;
+	void ReportEndpointTransition(const std::string_view& endpoint, const EndpointHealth::Transition& transition);
+
+	// Latency, hedging and buffer sizes are all tracked per endpoint, ignoring the query string
+	static std::string_view GetEndpoint(const std::string& requestURL) { return std::string_view(requestURL).substr(0, requestURL.find('?')); }
+
+	struct ResponseSink
+	{
+		std::string* response;
+		size_t maxSize;
+		bool limitExceeded = false;
+	};
+
+	static size_t WriteCallback(char* ptr, size_t size, size_t nmemb, void* userData);
+	static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userData);// Watches for Set-Cookie
+
+	struct GetTransfer : public FetchEngine::Transfer, public RequestCoalescer::Waiter
+	{
+		GetTransfer(FinderTarget& target, const std::string& url, std::string& response,
+			CURLModificationFunction curlModFunction, const ModificationData* modificationData);
+
+		bool Configure(CURL* curl) override;
+		void Complete(CURL* curl, const CURLcode& result) override;
+		void Cancelled(CURL* curl) override;
+		bool IsCancelled() const override { return target.stop; }// For both the engine and the coalescer
+
+		static int ProgressCallback(void* userData, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
+
+		void RecordTransferSize(CURL* curl);
+
+		void Deliver(const SharedResponse& response) override;
+		void Accept(const SharedResponse& response);
+
+		// Requests made with different option functions may send different headers, so they aren't interchangeable
+		const void* GetOptionsTag() const { return reinterpret_cast<const void*>(curlModFunction); }
+
+		FinderTarget& target;
+		const std::string& url;
+		ResponseSink sink;
+		CURLModificationFunction curlModFunction;
+		const ModificationData* modificationData;
+
+		CURLcode result = CURLE_OK;
+		long responseCode = 0;
+		long httpVersion = CURL_HTTP_VERSION_NONE;
+		bool completed = false;
+		std::coroutine_handle<> continuation;
+
+		RequestCoalescer* coalescer = nullptr;// Set when leading a shared request, which must report its response
+		ResponseBufferPool::Buffer* pooledBuffer = nullptr;// Where the leader's body is taken from (if it wasn't the hedge)
+		SharedResponse sharedResponse;// For shared requests, the body lives here rather than in the sink
+		bool shared = false;// Response came from another target's transfer
+	};
+
+	bool FinishTransfer(const GetTransfer& transfer);
+
+protected:
+	class GetAwaiter
+	{
+	public:
+		GetAwaiter(FinderTarget& target, const std::string& url, std::string& response,
+			CURLModificationFunction curlModFunction, const ModificationData* modificationData, const FetchEngine::Priority& priority,
+			const size_t& egress = EgressPool::noEgress)
+			: priority(priority), egress(egress), transfer(target, url, response, curlModFunction, modificationData),
+			hedge(target, url, hedgeResponse, curlModFunction, modificationData) {}
+
+		// For a shared request (see GetShared())
+		GetAwaiter(FinderTarget& target, const std::string& url, ResponseBufferPool::Buffer& buffer, SharedResponse& response,
+			CURLModificationFunction curlModFunction, const ModificationData* modificationData)
+			: priority(FetchEngine::Priority::Routine), egress(EgressPool::noEgress), sharedResponse(&response), transfer(target, url, *buffer, curlModFunction, modificationData),
+			hedge(target, url, hedgeResponse, curlModFunction, modificationData) { transfer.pooledBuffer = &buffer; }
+
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<> awaiting);
+		bool await_resume();
+
+	private:
+		const FetchEngine::Priority priority;
+		const size_t egress;// Only given for warm-ups
+		SharedResponse* const sharedResponse = nullptr;
+		std::string hedgeResponse;
+		GetTransfer transfer;
+		GetTransfer hedge;// Duplicate request the engine may send if the original is slow
+	};
+
 private:
-	static const UString::String userAgent;
+
+	// All of a target's transfers share one cookie store, which is loaded from and saved to cookieFile
+	const std::string cookieFile;
+	CURLSH* cookieShare = nullptr;
+	std::mutex cookieShareMutex;
+	bool cookiesLoaded = false;// Only accessed from the engine thread
+	std::atomic<bool> cookiesChanged = false;// Since the cookie file was last written
+	bool detached = false;// Guarded by sinkMutex; the cookie file belongs to the replacement
+
+	static void LockCookieShare(CURL*, curl_lock_data, curl_lock_access, void* userData);
+	static void UnlockCookieShare(CURL*, curl_lock_data, void* userData);
+	void SaveCookies();
+
+	static const std::chrono::system_clock::duration cookieExpiryMargin;
+	static const std::chrono::system_clock::duration maxSessionAge;// For sessions whose cookies don't say when they expire
+	bool hasSession = false;
+	std::chrono::system_clock::time_point sessionRefreshedTime;
+	std::chrono::system_clock::time_point sessionExpiryTime;
+	std::atomic<bool> sessionRejected = false;
+	std::chrono::system_clock::time_point GetEarliestCookieExpiry();
+
+	std::atomic<size_t> maxResponseSize;
+	std::atomic<unsigned long long> requestCount = 0;
+	std::atomic<unsigned long long> wireBytes = 0;
+	std::atomic<unsigned long long> decodedBytes = 0;
+	std::atomic<unsigned long long> sharedCount = 0;
 
 	bool OnAppointmentsAvailable(const std::string& appointmentInfo);
+	std::atomic<bool> reportedDuringCheck = false;
+	std::atomic<bool> alreadyReported = false;
+
+	mutable std::mutex snapshotMutex;
+	std::string stateSnapshot;
+	void CaptureState();
+
+	// Published to the status API after every check
+	std::chrono::system_clock::time_point lastCheckTime;
+	bool lastCheckFound = false;
+	std::string lastFoundMessage;
+	void PublishStatus();
+	void PostStatusEvent(const std::string& type, cJSON* data) const;// Takes ownership of data
+	static std::string PrintJSON(cJSON* root);// Deletes root
+
+	// Checks run on a fixed grid (offset by phase) rather than a period after the last one finished, so
+	// targets that start out apart stay apart.  Each slot gets a small jitter that depends only on the
+	// target name and slot number.
+	double phase = 0.0;
+	static const double jitterFraction;
+	std::chrono::system_clock::time_point scheduleStart;
+	std::atomic<double> periodScale = 1.0;
+	std::chrono::system_clock::duration GetScheduledPeriod() const;
+	std::chrono::system_clock::time_point GetNextScheduledCheck(const std::chrono::system_clock::time_point& now) const;
+	std::chrono::system_clock::duration GetJitter(const long long& slot, const std::chrono::system_clock::duration& period) const;
+
+	std::atomic<bool> checking = false;
+	std::atomic<bool> finished = false;
+	std::atomic<std::chrono::steady_clock::time_point> checkStartTime;
+	std::atomic<std::chrono::system_clock::time_point> nextCheckDue = std::chrono::system_clock::time_point::max();
+	std::atomic<unsigned long long> checkCount = 0;
+
+	mutable std::mutex durationMutex;
+	std::array<std::chrono::steady_clock::duration, 100> recentCheckDurations;
+	void RecordCheckDuration(const std::chrono::steady_clock::duration& duration);
+
+	// Servers close idle connections long before the next check, so this long before it's due, the check's first
+	// requests are sent once each through the connections it will use.  cURL keeps those connections afterward and
+	// hands them to the check.
+	static const std::chrono::system_clock::duration warmUpLead;
+	std::map<std::string, bool, std::less<>> multiplexedOrigins;// Whether each host answered over HTTP/2; check thread only
+	Task<bool> WarmUp(const UpcomingRequests& upcoming);
+	Task<bool> WarmUpConnection(const UpcomingRequests& upcoming, const size_t& egress, std::string& response);
+	static std::string_view GetOrigin(const std::string& requestURL);
 
 	void Sleep();
 
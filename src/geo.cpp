@@ -0,0 +1,41 @@
+// File:  geo.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Distances between coordinates and the square latitude/longitude grid cells used to
+//        find nearby points without comparing against every one.
+
+// Local headers
+#include "geo.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+const double Geo::milesPerDegree(69.05);
+
+double Geo::GetDistance(const double& latitudeA, const double& longitudeA, const double& latitudeB, const double& longitudeB)
+{
+	const double earthRadius(3958.8);// [miles]
+	const double toRadians(std::numbers::pi / 180.0);
+	const double dLatitude((latitudeB - latitudeA) * toRadians);
+	const double dLongitude((longitudeB - longitudeA) * toRadians);
+	const double h(std::sin(dLatitude * 0.5) * std::sin(dLatitude * 0.5) +
+		std::cos(latitudeA * toRadians) * std::cos(latitudeB * toRadians) * std::sin(dLongitude * 0.5) * std::sin(dLongitude * 0.5));
+	return 2.0 * earthRadius * std::asin(std::min(1.0, std::sqrt(h)));
+}
+
+double Geo::GetMilesPerDegreeLongitude(const double& latitude)
+{
+	return milesPerDegree * std::max(std::cos(latitude * std::numbers::pi / 180.0), 0.1);
+}
+
+int Geo::GetCellIndex(const double& degrees, const double& cellSize)
+{
+	return static_cast<int>(std::floor(degrees / cellSize));
+}
+
+long long Geo::GetCellKey(const int& row, const int& column)
+{
+	return static_cast<long long>(row) * 1000000LL + column;
+}
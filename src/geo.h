@@ -0,0 +1,26 @@
+// File:  geo.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Distances between coordinates and the square latitude/longitude grid cells used to
+//        find nearby points without comparing against every one.
+
+#ifndef GEO_H_
+#define GEO_H_
+
+namespace Geo
+{
+
+extern const double milesPerDegree;// Of latitude (and of longitude at the equator)
+
+double GetDistance(const double& latitudeA, const double& longitudeA, const double& latitudeB, const double& longitudeB);// [miles]
+
+// Never less than a tenth of milesPerDegree, so spans computed from it stay finite near the poles
+double GetMilesPerDegreeLongitude(const double& latitude);
+
+// Cells are cellSize [deg] on a side; rows come from latitude and columns from longitude
+int GetCellIndex(const double& degrees, const double& cellSize);
+long long GetCellKey(const int& row, const int& column);
+
+}// namespace Geo
+
+#endif// GEO_H_
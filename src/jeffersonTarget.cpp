@@ -7,31 +7,73 @@
 #include "jeffersonTarget.h"
 #include "email/curlUtilities.h"
 
-bool JeffersonTarget::AppointmentsAvailable(std::string&)
+const std::string JeffersonTarget::defaultURL("https://www.jeffersonhealth.org/coronavirus-covid-19/vaccination-clinics.html");
+
+Task<bool> JeffersonTarget::AppointmentsAvailable(std::string&)
 {
-	std::string response;
-	if (!DoCURLGet(url, response))
+	if (GetEndpointAccess(url) == EndpointHealth::Access::Skip)
+		co_return false;
+
+	auto response(GetResponseBuffer(url));
+	if (!co_await Get(url, *response, &SetOptions))
 	{
 		SendLogMessage("Jefferson check failed");
-		return false;
+		co_return false;
+	}
+
+	if (!DoesNotHaveThreeRegistrationFullStatements(*response))
+	{
+		wasAvailable = false;
+		PublishAvailability(GetSubscriptionLocation(), false);
+		co_return false;
+	}
+
+	if (wasAvailable)
+	{
+		PublishAvailability(GetSubscriptionLocation(), true);
+		AlreadyReported();
+		co_return true;
+	}
+
+	// A partially loaded page also looks like open registration, so make sure before alerting
+	if (!co_await Confirm(url, *response, &SetOptions))
+	{
+		SendLogMessage("Jefferson confirm failed");
+		co_return false;
 	}
 
-	return DoesNotHaveThreeRegistrationFullStatements(response);
+	wasAvailable = DoesNotHaveThreeRegistrationFullStatements(*response);
+	PublishAvailability(GetSubscriptionLocation(), wasAvailable);
+	if (!wasAvailable)
+		SendLogMessage("Jefferson availability not confirmed");
+
+	co_return wasAvailable;
 }
 
-bool JeffersonTarget::DoesNotHaveThreeRegistrationFullStatements(const std::string& html)
+void JeffersonTarget::SaveState(SnapshotWriter& writer) const
 {
-	std::string::size_type position(0);
-	unsigned int count(0);
-	const std::string testString("Registration is currently full at this location.");
-	do
-	{
-		position = html.find(testString, position + 1);
-		if (position != std::string::npos)
-			++count;
-	} while (position != std::string::npos);
+	FinderTarget::SaveState(writer);
+	writer.Write(wasAvailable);
+}
 
-	return count < 3;
+bool JeffersonTarget::LoadState(SnapshotReader& reader)
+{
+	return FinderTarget::LoadState(reader) && reader.Read(wasAvailable);
+}
+
+void JeffersonTarget::AddStatus(cJSON* status) const
+{
+	cJSON_AddBoolToObject(status, "registrationOpen", wasAvailable);
+}
+
+// All clinics share one registration page
+SubscriptionEngine::Location JeffersonTarget::GetSubscriptionLocation() const
+{
+	SubscriptionEngine::Location location;
+	location.target = name;
+	location.id = "registration";
+	location.description = "Vaccination clinic registration";
+	return location;
 }
 
 bool JeffersonTarget::SetOptions(CURL* curl, const ModificationData*)
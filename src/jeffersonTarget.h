@@ -12,15 +12,28 @@
 class JeffersonTarget : public FinderTarget
 {
 public:
-	JeffersonTarget(const UString::String& url, MainFrame* mainFrame,
-		const unsigned int& checkPerod) : FinderTarget(url, mainFrame, checkPerod, _T("Jefferson")) {}
+	JeffersonTarget(const std::string& url, MainFrame* mainFrame, FetchEngine* fetchEngine,
+		const unsigned int& checkPerod) : FinderTarget(url, mainFrame, fetchEngine, checkPerod, "Jefferson") {}
+
+	static const std::string defaultURL;
+
+	static bool DoesNotHaveThreeRegistrationFullStatements(const std::string& html);
+
+	bool IsDemoted() const override { return IsEndpointDemoted(url); }
 
 protected:
-	bool AppointmentsAvailable(std::string& message) override;
+	Task<bool> AppointmentsAvailable(std::string& message) override;
+
+	void SaveState(SnapshotWriter& writer) const override;
+	bool LoadState(SnapshotReader& reader) override;
+	void AddStatus(cJSON* status) const override;
+	UpcomingRequests GetUpcomingRequests(const std::chrono::system_clock::time_point&) const override { return UpcomingRequests{ url, 1, &SetOptions }; }
 
 private:
+	bool wasAvailable = false;// Only alert when registration opens, not on every check while it stays open
+	SubscriptionEngine::Location GetSubscriptionLocation() const;
+
 	static bool SetOptions(CURL* curl, const ModificationData*);
-	static bool DoesNotHaveThreeRegistrationFullStatements(const std::string& html);
 };
 
 #endif// JEFFERSON_TARGET_H_
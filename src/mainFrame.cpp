@@ -5,31 +5,94 @@
 #include "cvsTarget.h"
 #include "jeffersonTarget.h"
 #include "vaccineFinderApp.h"
+#include "simulator.h"
 
 // wxWidgets headers
 #include <wx/fileconf.h>
 
 // Standard C++ headers
 #include <iomanip>
+#include <algorithm>
 
 const wxString MainFrame::configFileName(_T("vaccineFinder.config"));
-
-MainFrame::MainFrame() : wxFrame(nullptr, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxDEFAULT_FRAME_STYLE)
+const std::string MainFrame::snapshotFileName("vaccineFinder.snapshot");
+const std::string MainFrame::subscriptionsFileName("vaccineFinder.subscriptions");
+const std::string MainFrame::logChannel("log");
+const std::string MainFrame::statusChannel("status");
+const int MainFrame::snapshotInterval(5 * 60 * 1000);
+const int MainFrame::uiTickInterval(100);
+const int MainFrame::watchdogInterval(10 * 1000);
+const double MainFrame::minPeriodScale(0.5);
+
+MainFrame::MainFrame() : wxFrame(nullptr, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxDEFAULT_FRAME_STYLE), uiTimer(this, idUITimer), snapshotTimer(this, idSnapshotTimer), watchdogTimer(this, idWatchdogTimer)
 {
 	curl_global_init(CURL_GLOBAL_ALL);// Do this before launching threads
 
 	CreateControls();
 	SetProperties();
+
+	fetchEngine = std::make_unique<FetchEngine>(maxConcurrentStreams, hedgeBudget, ToUTF8Vector(egresses));
+	if (statusServerEnabled && statusPort > 0)
+		statusServer = std::make_unique<StatusServer>(static_cast<unsigned short>(statusPort));
+	if (publishAvailability)
+	{
+		availabilityTable = std::make_unique<AvailabilityTable>(AvailabilityTable::defaultName);
+		if (!availabilityTable->IsOk())
+			availabilityTable.reset();
+	}
+
+	subscriptions.SetNotifier([this](const SubscriptionEngine::Subscriber& subscriber, const SubscriptionEngine::Location& location, const bool& available)
+	{
+		NotifySubscriber(subscriber, location, available);
+	});
+	subscriptions.Load(subscriptionsFileName);
+	if (subscriptions.GetSubscriberCount() > 0)
+		SendMessageForHistory(subscriptions.GetSummary());
+	for (const auto& channel : subscriptions.GetChannels())
+	{
+		if (!CanDeliver(channel))
+			SendMessageForHistory("Subscription channel '" + channel + "' isn't available; matches for it will be logged here instead");
+	}
+
+	SnapshotFile::Read(snapshotFileName, snapshotSections);
+	const auto engineSection(snapshotSections.find("fetchEngine"));
+	if (engineSection != snapshotSections.end())
+	{
+		SnapshotReader reader(engineSection->second);
+		fetchEngine->LoadState(reader);
+	}
+
+	snapshotTimer.Start(snapshotInterval);
+	uiTimer.Start(uiTickInterval);
+	watchdogTimer.Start(watchdogInterval);
 }
 
 MainFrame::~MainFrame()
 {
 	WriteConfiguration();
+	if (simulationThread.joinable())
+		simulationThread.join();
+
+	watchdogTimer.Stop();
+	snapshotTimer.Stop();
+	uiTimer.Stop();
+	StopTargets();
+	WriteSnapshot();
+
+	// Targets use the engine, and both use cURL
+	finderTargets.clear();
+	ReleaseAbandonedTargets();
+	statusServer.reset();
+	availabilityTable.reset();
+	fetchEngine.reset();
 	curl_global_cleanup();
 }
 
 BEGIN_EVENT_TABLE(MainFrame, wxFrame)
 	EVT_BUTTON(idUpdateButton, MainFrame::UpdateButtonClickedEvent)
+	EVT_TIMER(idSnapshotTimer, MainFrame::SnapshotTimerEvent)
+	EVT_TIMER(idUITimer, MainFrame::UITimerEvent)
+	EVT_TIMER(idWatchdogTimer, MainFrame::WatchdogTimerEvent)
 END_EVENT_TABLE();
 
 void MainFrame::CreateControls()
@@ -96,7 +159,7 @@ void MainFrame::SetProperties()
 	LoadConfiguration();
 }
 
-void MainFrame::UpdateCVSLocations(const std::vector<std::string> locations)
+void MainFrame::UpdateCVSLocations(const std::vector<std::string>& locations)
 {
 	wxArrayString wxLocations;
 	for (const auto& loc : locations)
@@ -125,7 +188,78 @@ void MainFrame::UpdateCVSLocations(const std::vector<std::string> locations)
 	}
 }
 
-void MainFrame::SendMessageForHistory(const std::string s)
+void MainFrame::PublishStatus(const std::string& source, std::string&& json)
+{
+	if (statusServer)
+		statusServer->PublishStatus(source, std::move(json));
+}
+
+void MainFrame::PostStatusEvent(const std::string& type, std::string&& json)
+{
+	if (statusServer)
+		statusServer->PostEvent(type, std::move(json));
+}
+
+// Everything that arrived since the last tick is applied at once, so UI work scales with what changed rather than with how many messages were sent
+void MainFrame::UITimerEvent(wxTimerEvent& WXUNUSED(event))
+{
+	std::string history;
+	std::map<std::string, std::vector<std::string>> latestLocations;
+	std::vector<std::string> notifications;
+
+	UIEvent event;
+	while (uiEvents.Pop(event))
+	{
+		switch (event.type)
+		{
+		case UIEvent::Type::Log:
+			history += GetTimeStamp() + " : " + event.text + "\n";
+			break;
+
+		case UIEvent::Type::Appointment:
+			history += GetTimeStamp() + " : " + event.text + "\n";
+			notifications.push_back(std::move(event.text));
+			break;
+
+		case UIEvent::Type::CVSLocations:
+			latestLocations[event.source] = std::move(event.locations);
+			break;
+		}
+	}
+
+	if (!history.empty())
+		historyTextCtrl->AppendText(wxString::FromUTF8(history.c_str()));
+
+	for (const auto& locations : latestLocations)
+		UpdateCVSLocations(locations.second);
+
+	// Message boxes are modal, so do these last.  The modal loop still dispatches timer events, so stop the timer
+	// until they're closed; otherwise each tick would open more boxes on top of these.
+	if (notifications.empty())
+		return;
+
+	uiTimer.Stop();
+	for (const auto& message : notifications)
+		DoAppointmentNotification(message);
+	uiTimer.Start(uiTickInterval);
+}
+
+void MainFrame::RunSimulation(const std::string& timelineFileName)
+{
+	simulationThread = std::thread([this, timelineFileName]()
+	{
+		Simulator::RunFromCommandLine(timelineFileName, [this](const std::string& message)
+		{
+			UIEvent event;
+			event.type = UIEvent::Type::Log;
+			event.source = "Simulator";
+			event.text = message;
+			PostUIEvent(std::move(event));
+		});
+	});
+}
+
+void MainFrame::SendMessageForHistory(const std::string& s)
 {
 	historyTextCtrl->AppendText(GetTimeStamp() + _T(" : ") + s + _T("\n"));
 }
@@ -147,25 +281,263 @@ std::string MainFrame::GetTimeStamp()
 	return timeStamp.str();
 }
 
-void MainFrame::DoAppointmentNotification(const std::string message)
+void MainFrame::DoAppointmentNotification(const std::string& message)
 {
 	wxMessageBox(message, _T("Found Appointment"));
 }
 
+bool MainFrame::CanDeliver(const std::string& channel) const
+{
+	return channel == logChannel || (channel == statusChannel && statusServer);
+}
+
+// Called on target threads
+void MainFrame::NotifySubscriber(const SubscriptionEngine::Subscriber& subscriber, const SubscriptionEngine::Location& location, const bool& available)
+{
+	const auto& channels(subscriber.channels);
+	const bool toStatus(statusServer && std::find(channels.begin(), channels.end(), statusChannel) != channels.end());
+	const bool toLog(!toStatus || std::find(channels.begin(), channels.end(), logChannel) != channels.end());
+	const std::string& description(location.description.empty() ? location.id : location.description);
+
+	if (toStatus)
+	{
+		cJSON* data(cJSON_CreateObject());
+		cJSON_AddStringToObject(data, "subscriber", subscriber.id.c_str());
+		cJSON* channelArray(cJSON_AddArrayToObject(data, "channels"));
+		for (const auto& c : channels)
+			cJSON_AddItemToArray(channelArray, cJSON_CreateString(c.c_str()));
+		cJSON_AddStringToObject(data, "target", location.target.c_str());
+		cJSON_AddStringToObject(data, "location", location.id.c_str());
+		cJSON_AddStringToObject(data, "description", description.c_str());
+		cJSON_AddBoolToObject(data, "available", available);
+
+		if (char* printed = cJSON_PrintUnformatted(data))
+		{
+			PostStatusEvent("notification", printed);
+			cJSON_free(printed);
+		}
+		cJSON_Delete(data);
+	}
+
+	if (toLog)
+	{
+		UIEvent event;
+		event.type = UIEvent::Type::Log;
+		event.source = "Subscriptions";
+		event.text = "For " + subscriber.id + ":  " + location.target + ' ' + description + (available ? " is available" : " is no longer available");
+		PostUIEvent(std::move(event));
+	}
+}
+
 void MainFrame::UpdateButtonClickedEvent(wxCommandEvent& WXUNUSED(event))
 {
 	const unsigned int cvsCheckPeriod(300);// [sec]
 	const unsigned int riteAidCheckPeriod(120);// [sec]
 	const unsigned int jeffersonPeriod(300);// [sec]
 
+	for (const auto& target : finderTargets)
+		SendMessageForHistory(target->GetTransferSummary());
+	if (!finderTargets.empty())
+	{
+		SendMessageForHistory(fetchEngine->GetHedgeSummary());
+		SendMessageForHistory(fetchEngine->GetWarmUpSummary());
+		SendMessageForHistory(fetchEngine->GetEgressSummary());
+		if (subscriptions.GetSubscriberCount() > 0)
+			SendMessageForHistory(subscriptions.GetSummary());
+	}
+
+	// Carry state over to the new targets (where their settings allow)
+	StopTargets();
+	WriteSnapshot();
 	finderTargets.clear();
+	ReleaseAbandonedTargets();
+	watchdog.Reset();
+	if (statusServer)
+		statusServer->ClearStatus();
+
+	// Settings are captured now, so the watchdog can recreate a target exactly as it was
+	targetFactories.clear();
 	if (nonPhillyRadioButtion->GetValue())
 	{
-		finderTargets.push_back(std::make_unique<CVSTarget>(_T("https://www.cvs.com/immunizations/covid-19-vaccine"), this, cvsCheckPeriod, ToUStringVector(GetCVSExcludeLocations())));
-		finderTargets.push_back(std::make_unique<JeffersonTarget>(_T("https://www.jeffersonhealth.org/coronavirus-covid-19/vaccination-clinics.html"), this, jeffersonPeriod));
+		const auto excludeLocations(ToUTF8Vector(GetCVSExcludeLocations()));
+		targetFactories.push_back([this, excludeLocations, cvsCheckPeriod]()
+		{
+			return std::make_unique<CVSTarget>(CVSTarget::defaultURL, this, fetchEngine.get(), cvsCheckPeriod, excludeLocations);
+		});
+		targetFactories.push_back([this, jeffersonPeriod]()
+		{
+			return std::make_unique<JeffersonTarget>(JeffersonTarget::defaultURL, this, fetchEngine.get(), jeffersonPeriod);
+		});
 	}
 
-	finderTargets.push_back(std::make_unique<RiteAidTarget>(_T("https://www.riteaid.com/pharmacy/apt-scheduler#"), this, ToUStringVector(GetRiteAidLocations(true)), riteAidCheckPeriod, phillyRadioButtion->GetValue()));
+	const auto riteAidLocations(ToUTF8Vector(GetRiteAidLocations(true)));
+	const bool phillyMode(phillyRadioButtion->GetValue());
+	targetFactories.push_back([this, riteAidLocations, riteAidCheckPeriod, phillyMode]()
+	{
+		return std::make_unique<RiteAidTarget>(RiteAidTarget::defaultURL, this, fetchEngine.get(), riteAidLocations, riteAidCheckPeriod, phillyMode);
+	});
+
+	for (const auto& factory : targetFactories)
+		finderTargets.push_back(factory());
+
+	AssignSchedulePhases();
+
+	// Start only once construction is complete; the check loop calls into the derived classes
+	for (auto& target : finderTargets)
+	{
+		const auto section(snapshotSections.find(target->GetName()));
+		StartTarget(*target, section != snapshotSections.end() ? section->second : std::string());
+	}
+}
+
+void MainFrame::StartTarget(FinderTarget& target, const std::string& snapshot)
+{
+	target.SetMaxResponseSize(maxResponseSize);
+	target.SetAvailabilityTable(availabilityTable.get());
+	target.SetSubscriptionEngine(&subscriptions);
+	if (!snapshot.empty())
+		target.RestoreState(snapshot);
+	target.BeginCheckLoop();
+}
+
+void MainFrame::WatchdogTimerEvent(wxTimerEvent& WXUNUSED(event))
+{
+	// Let go of replaced targets once their loops have exited (destroying one joins its thread)
+	abandonedTargets.erase(std::remove_if(abandonedTargets.begin(), abandonedTargets.end(),
+		[](const std::unique_ptr<FinderTarget>& target) { return target->HasFinished(); }), abandonedTargets.end());
+
+	for (size_t i = 0; i < finderTargets.size(); ++i)
+	{
+		const auto verdict(watchdog.Evaluate(*finderTargets[i]));
+		for (const auto& alert : verdict.alerts)
+		{
+			SendMessageForHistory(alert);
+
+			cJSON* data(cJSON_CreateObject());
+			cJSON_AddStringToObject(data, "target", finderTargets[i]->GetName().c_str());
+			cJSON_AddStringToObject(data, "message", alert.c_str());
+			if (char* printed = cJSON_PrintUnformatted(data))
+			{
+				PostStatusEvent("watchdog", printed);
+				cJSON_free(printed);
+			}
+			cJSON_Delete(data);
+		}
+
+		if (verdict.restart)
+			RestartTarget(i);
+	}
+
+	RebalanceCheckPeriods();
+
+	if (statusServer)
+		statusServer->PublishStatus("watchdog", watchdog.GetStatus());
+}
+
+// The old target is stopped but not joined - if it's really stuck, joining would hang the UI.  It has
+// the same name and cookie file as its replacement, so it's detached before the replacement starts.
+void MainFrame::RestartTarget(const size_t& i)
+{
+	auto& target(finderTargets[i]);
+	target->Stop();
+	target->Detach();
+
+	auto replacement(targetFactories[i]());
+	replacement->SetSchedulePhase(target->GetSchedulePhase());
+	const std::string snapshot(target->GetStateSnapshot());
+
+	abandonedTargets.push_back(std::move(target));
+	target = std::move(replacement);
+	StartTarget(*target, snapshot);
+}
+
+// Budget is counted in checks per second; a demoted target only makes the occasional probe
+void MainFrame::RebalanceCheckPeriods()
+{
+	double healthyRate(0.0), freedRate(0.0);
+	for (const auto& target : finderTargets)
+	{
+		const double rate(1.0 / std::chrono::duration<double>(target->GetCheckPeriod()).count());
+		if (target->IsDemoted())
+			freedRate += rate;
+		else
+			healthyRate += rate;
+	}
+
+	const double scale(healthyRate > 0.0 ? std::max(minPeriodScale, healthyRate / (healthyRate + freedRate)) : 1.0);
+	for (auto& target : finderTargets)
+		target->SetPeriodScale(target->IsDemoted() ? 1.0 : scale);
+}
+
+// Spreads targets evenly over their periods.  Hosts are taken in turn, so targets that hit the same
+// site end up as far apart as possible rather than next to each other.
+void MainFrame::AssignSchedulePhases()
+{
+	std::map<std::string, std::vector<FinderTarget*>> hostTargets;
+	for (auto& target : finderTargets)
+		hostTargets[target->GetHost()].push_back(target.get());
+
+	std::vector<FinderTarget*> order;
+	for (size_t i = 0; order.size() < finderTargets.size(); ++i)
+	{
+		for (const auto& host : hostTargets)
+		{
+			if (i < host.second.size())
+				order.push_back(host.second[i]);
+		}
+	}
+
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i]->SetSchedulePhase(static_cast<double>(i) / order.size());
+}
+
+void MainFrame::SnapshotTimerEvent(wxTimerEvent& WXUNUSED(event))
+{
+	WriteSnapshot();
+}
+
+// Targets capture their state after every check, so it is current once their loops have ended.  Abandoned
+// targets are only stopped (see RestartTarget()).
+void MainFrame::StopTargets()
+{
+	for (auto& target : finderTargets)
+		target->Stop();
+	for (auto& target : abandonedTargets)
+		target->Stop();
+
+	for (auto& target : finderTargets)
+		target->Join();
+}
+
+// Destroying a target joins its thread, so any that are still stuck are leaked rather than waited for (they were
+// detached, so they won't touch the fetch engine once it's destroyed)
+void MainFrame::ReleaseAbandonedTargets()
+{
+	for (auto& target : abandonedTargets)
+	{
+		if (!target->HasFinished())
+			static_cast<void>(target.release());
+	}
+
+	abandonedTargets.clear();
+}
+
+// Sections for targets that aren't running now are kept, so switching modes doesn't lose them
+void MainFrame::WriteSnapshot()
+{
+	for (const auto& target : finderTargets)
+	{
+		std::string state(target->GetStateSnapshot());
+		if (!state.empty())
+			snapshotSections[target->GetName()] = std::move(state);
+	}
+
+	SnapshotWriter engineWriter;
+	fetchEngine->SaveState(engineWriter);
+	snapshotSections["fetchEngine"] = engineWriter.GetData();
+
+	if (!SnapshotFile::Write(snapshotFileName, snapshotSections))
+		SendMessageForHistory("Failed to write " + snapshotFileName);
 }
 
 wxString MainFrame::ArrayToConfigString(const wxArrayString& a)
@@ -186,11 +558,11 @@ wxArrayString MainFrame::ConfigStringToArray(const wxString& s)
 	return a;
 }
 
-std::vector<UString::String> MainFrame::ToUStringVector(const wxArrayString& a)
+std::vector<std::string> MainFrame::ToUTF8Vector(const wxArrayString& a)
 {
-	std::vector<UString::String> v;
+	std::vector<std::string> v;
 	for (const auto& s : a)
-		v.push_back(UString::ToStringType(s.ToStdString()));
+		v.push_back(s.ToUTF8().data());
 	return v;
 }
 
@@ -217,6 +589,14 @@ void MainFrame::WriteConfiguration()
 	config->Write(_T("/search/riteAid/locations"), ArrayToConfigString(GetRiteAidLocations(false)));
 	config->Write(_T("/search/cvs/knownLocations"), ArrayToConfigString(cvsLocationCheckListBox->GetStrings()));
 	config->Write(_T("/search/cvs/excludeLocations"), ArrayToConfigString(GetCVSExcludeLocations()));
+
+	config->Write(_T("/fetch/maxResponseSize"), static_cast<long>(maxResponseSize));
+	config->Write(_T("/fetch/maxConcurrentStreams"), static_cast<long>(maxConcurrentStreams));
+	config->Write(_T("/fetch/hedgeBudget"), hedgeBudget);
+	config->Write(_T("/fetch/egresses"), ArrayToConfigString(egresses));
+	config->Write(_T("/status/enabled"), statusServerEnabled);
+	config->Write(_T("/status/port"), static_cast<long>(statusPort));
+	config->Write(_T("/status/publishAvailability"), publishAvailability);
 }
 
 void MainFrame::LoadConfiguration()
@@ -266,6 +646,30 @@ void MainFrame::LoadConfiguration()
 		}
 	}
 
+	long tempLong;
+	if (config->Read(_T("/fetch/maxResponseSize"), &tempLong) && tempLong > 0)
+		maxResponseSize = static_cast<size_t>(tempLong);
+
+	if (config->Read(_T("/fetch/maxConcurrentStreams"), &tempLong) && tempLong > 0)
+		maxConcurrentStreams = static_cast<unsigned int>(tempLong);
+
+	if (config->Read(_T("/status/enabled"), &tempBool))
+		statusServerEnabled = tempBool;
+
+	if (config->Read(_T("/status/port"), &tempLong) && tempLong >= 0 && tempLong <= 65535)
+		statusPort = static_cast<unsigned int>(tempLong);
+
+	if (config->Read(_T("/status/publishAvailability"), &tempBool))
+		publishAvailability = tempBool;
+
+	double tempDouble;
+	if (config->Read(_T("/fetch/hedgeBudget"), &tempDouble) && tempDouble >= 0.0)
+		hedgeBudget = tempDouble;
+
+	tempString.Clear();
+	if (config->Read(_T("/fetch/egresses"), &tempString) && !tempString.IsEmpty())
+		egresses = ConfigStringToArray(tempString);
+
 	int x(0), y(0);
 	if (config->Read(_T("/Window/XPosition"), &x) &&
 		config->Read(_T("/Window/YPosition"), &y))
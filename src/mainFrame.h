@@ -3,6 +3,11 @@
 
 // Local headers
 #include"finderTarget.h"
+#include "mpscQueue.h"
+#include "statusServer.h"
+#include "availabilityTable.h"
+#include "subscriptionEngine.h"
+#include "targetWatchdog.h"
 
 // wxWidgets headers
 #include <wx/wx.h>
@@ -10,6 +15,9 @@
 // Standard C++ headers
 #include <vector>
 #include <memory>
+#include <map>
+#include <functional>
+#include <thread>
 
 // The main frame class
 class MainFrame : public wxFrame
@@ -18,13 +26,46 @@ public:
 	MainFrame();
 	~MainFrame();
 
-	void UpdateCVSLocations(const std::vector<std::string> locations);
-	void SendMessageForHistory(const std::string s);
-	void DoAppointmentNotification(const std::string message);
+	struct UIEvent
+	{
+		enum class Type
+		{
+			Log,
+			Appointment,
+			CVSLocations// Only the newest list from each source is applied
+		};
+
+		Type type = Type::Log;
+		std::string source;
+		std::string text;
+		std::vector<std::string> locations;
+	};
+
+	// Thread-safe and doesn't block; events are applied on the next UI tick
+	void PostUIEvent(UIEvent&& event) { uiEvents.Push(std::move(event)); }
+
+	// Thread-safe; ignored when the status server is disabled
+	void PublishStatus(const std::string& source, std::string&& json);
+	void PostStatusEvent(const std::string& type, std::string&& json);
+
+	// Replays a recorded timeline (see Simulator) in the background; progress and the report go to the history
+	void RunSimulation(const std::string& timelineFileName);
 
 private:
 	static const wxString configFileName;
 
+	void UpdateCVSLocations(const std::vector<std::string>& locations);
+	void SendMessageForHistory(const std::string& s);
+	void DoAppointmentNotification(const std::string& message);
+
+	static const int uiTickInterval;// [msec]
+	MPSCQueue<UIEvent> uiEvents;
+	wxTimer uiTimer;
+	void UITimerEvent(wxTimerEvent& event);
+
+	std::thread simulationThread;
+	static const std::string snapshotFileName;
+
 	// Functions that do some of the frame initialization and control positioning
 	void CreateControls();
 	void SetProperties();
@@ -42,23 +83,78 @@ private:
 	// The event IDs
 	enum MainFrameEventID
 	{
-		idUpdateButton = wxID_HIGHEST + 200
+		idUpdateButton = wxID_HIGHEST + 200,
+		idSnapshotTimer,
+		idUITimer,
+		idWatchdogTimer
 	};
 
 	// Button events
 	void UpdateButtonClickedEvent(wxCommandEvent& event);
 
+	// Timer events
+	void SnapshotTimerEvent(wxTimerEvent& event);
+	void WatchdogTimerEvent(wxTimerEvent& event);
+
 	void WriteConfiguration();
 	void LoadConfiguration();
 
+	std::unique_ptr<FetchEngine> fetchEngine;
+	unsigned int maxConcurrentStreams = FetchEngine::defaultMaxConcurrentStreams;
+	double hedgeBudget = FetchEngine::defaultHedgeBudget;// Fraction of requests that may be duplicated; zero disables hedging
+	wxArrayString egresses;// Proxies and interfaces to spread requests over (see EgressPool); empty for direct only
+
+	std::unique_ptr<StatusServer> statusServer;
+	bool statusServerEnabled = false;// Listens on loopback only, but still opt-in
+	unsigned int statusPort = StatusServer::defaultPort;
+
+	std::unique_ptr<AvailabilityTable> availabilityTable;
+	bool publishAvailability = true;// In shared memory, for other local processes
+
+	// Other people's subscriptions.  Each subscriber's channels say where its matches go:  "log" (the history) or
+	// "status" (the status server's event stream, for a delivery service to pick up).  A match that no enabled
+	// channel would carry is logged, so nothing is dropped.
+	static const std::string subscriptionsFileName;
+	static const std::string logChannel;
+	static const std::string statusChannel;
+	SubscriptionEngine subscriptions;
+	bool CanDeliver(const std::string& channel) const;
+	void NotifySubscriber(const SubscriptionEngine::Subscriber& subscriber, const SubscriptionEngine::Location& location, const bool& available);
+
 	std::vector<std::unique_ptr<FinderTarget>> finderTargets;
+	size_t maxResponseSize = FinderTarget::defaultMaxResponseSize;// [bytes]
+
+	// Makes a new target with the same settings as the one at the same index in finderTargets
+	typedef std::function<std::unique_ptr<FinderTarget>()> TargetFactory;
+	std::vector<TargetFactory> targetFactories;
+	void StartTarget(FinderTarget& target, const std::string& snapshot);
+
+	// Hung targets are replaced, and kept here until their check loops finally exit
+	static const int watchdogInterval;// [msec]
+	wxTimer watchdogTimer;
+	TargetWatchdog watchdog;
+	std::vector<std::unique_ptr<FinderTarget>> abandonedTargets;
+	void RestartTarget(const size_t& i);
+	void ReleaseAbandonedTargets();
+
+	// Checks that demoted targets aren't making are given to healthy ones (up to this much faster than configured)
+	static const double minPeriodScale;
+	void RebalanceCheckPeriods();
+
+	// Runtime state is saved periodically and at shutdown, and restored into targets as they're created
+	static const int snapshotInterval;// [msec]
+	wxTimer snapshotTimer;
+	std::map<std::string, std::string> snapshotSections;
+	void StopTargets();
+	void AssignSchedulePhases();
+	void WriteSnapshot();
 	wxArrayString GetRiteAidLocations(const bool& encoded) const;
 	wxArrayString GetCVSExcludeLocations() const;
 
 	static std::string GetTimeStamp();
 	static wxString ArrayToConfigString(const wxArrayString& a);
 	static wxArrayString ConfigStringToArray(const wxString& s);
-	static std::vector<UString::String> ToUStringVector(const wxArrayString& a);
+	static std::vector<std::string> ToUTF8Vector(const wxArrayString& a);
 
 	DECLARE_EVENT_TABLE();
 };
@@ -0,0 +1,66 @@
+// File:  mpscQueue.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Lock-free multi-producer, single-consumer queue (Vyukov's linked-list design).  Push()
+//        may be called from any thread; Pop() only from the one consuming thread.  A push that is
+//        still in progress may not be visible to Pop() yet - it shows up on the next call.  Lock-free,
+//        but not allocation-free:  each Push() allocates one node.
+
+#ifndef MPSC_QUEUE_H_
+#define MPSC_QUEUE_H_
+
+// Standard C++ headers
+#include <atomic>
+#include <utility>
+
+template<typename T>
+class MPSCQueue
+{
+public:
+	MPSCQueue() : head(new Node), tail(head.load()) {}
+	~MPSCQueue()
+	{
+		T discard;
+		while (Pop(discard))
+			continue;
+		delete tail;
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	void Push(T value)
+	{
+		Node* node(new Node(std::move(value)));
+		Node* previous(head.exchange(node, std::memory_order_acq_rel));
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	bool Pop(T& value)
+	{
+		Node* next(tail->next.load(std::memory_order_acquire));
+		if (!next)
+			return false;
+
+		// The popped node becomes the new (empty) front sentinel
+		value = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		Node() = default;
+		explicit Node(T&& value) : value(std::move(value)) {}
+
+		T value;
+		std::atomic<Node*> next = nullptr;
+	};
+
+	std::atomic<Node*> head;// Most recently pushed
+	Node* tail;// Sentinel in front of the oldest unpopped node; consumer only
+};
+
+#endif// MPSC_QUEUE_H_
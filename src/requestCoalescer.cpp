@@ -0,0 +1,109 @@
+// File:  requestCoalescer.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Single-flight sharing of identical requests.  While one request for a key is in flight,
+//        others for the same key wait for its response instead of going to the network, and a
+//        successful response is handed to later requests for a short while after it arrives.
+
+// Local headers
+#include "requestCoalescer.h"
+
+const std::chrono::steady_clock::duration RequestCoalescer::freshnessWindow(std::chrono::seconds(5));
+
+RequestCoalescer::Role RequestCoalescer::Join(const std::string& url, const void* options, Waiter* waiter, std::shared_ptr<const Response>& recent)
+{
+	const auto now(std::chrono::steady_clock::now());
+	std::lock_guard<std::mutex> lock(mutex);
+	RemoveStale(now);
+
+	auto it(flights.find(KeyView{ url, options }));
+	if (it == flights.end())
+		it = flights.emplace(Key{ url, options }, Flight()).first;
+
+	auto& flight(it->second);
+	if (flight.inFlight)
+	{
+		flight.waiters.push_back(waiter);
+		return Role::Follower;
+	}
+
+	if (flight.response)
+	{
+		recent = flight.response;
+		return Role::Fresh;
+	}
+
+	flight.inFlight = true;
+	return Role::Leader;
+}
+
+std::shared_ptr<const RequestCoalescer::Response> RequestCoalescer::Finish(const std::string& url, const void* options,
+	const CURLcode& result, const long& responseCode, std::string&& body)
+{
+	const auto response(std::make_shared<const Response>(Response{ result, responseCode, std::move(body) }));
+	std::vector<Waiter*> waiters;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto it(flights.find(KeyView{ url, options }));
+		if (it == flights.end())
+			return response;
+
+		waiters.swap(it->second.waiters);
+		it->second.inFlight = false;
+
+		// Failures are shared with whoever was already waiting, but the next request tries again
+		if (result == CURLE_OK && responseCode < 400)
+		{
+			it->second.response = response;
+			it->second.completedTime = std::chrono::steady_clock::now();
+		}
+		else
+			flights.erase(it);
+	}
+
+	// Waiters may resume (and finish) their checks here, so the lock must not be held
+	for (const auto& w : waiters)
+		w->Deliver(response);
+
+	return response;
+}
+
+void RequestCoalescer::ReleaseCancelled()
+{
+	std::vector<Waiter*> cancelled;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& flight : flights)
+		{
+			auto& waiters(flight.second.waiters);
+			for (auto it = waiters.begin(); it != waiters.end();)
+			{
+				if ((*it)->IsCancelled())
+				{
+					cancelled.push_back(*it);
+					it = waiters.erase(it);
+				}
+				else
+					++it;
+			}
+		}
+	}
+
+	if (cancelled.empty())
+		return;
+
+	const auto aborted(std::make_shared<const Response>(Response{ CURLE_ABORTED_BY_CALLBACK, 0, std::string() }));
+	for (const auto& w : cancelled)
+		w->Deliver(aborted);
+}
+
+void RequestCoalescer::RemoveStale(const std::chrono::steady_clock::time_point& now)
+{
+	for (auto it = flights.begin(); it != flights.end();)
+	{
+		if (!it->second.inFlight && (!it->second.response || it->second.completedTime + freshnessWindow < now))
+			it = flights.erase(it);
+		else
+			++it;
+	}
+}
@@ -0,0 +1,99 @@
+// File:  requestCoalescer.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Single-flight sharing of identical requests.  While one request for a key is in flight,
+//        others for the same key wait for its response instead of going to the network, and a
+//        successful response is handed to later requests for a short while after it arrives.
+
+#ifndef REQUEST_COALESCER_H_
+#define REQUEST_COALESCER_H_
+
+// cURL headers
+#include <curl/curl.h>
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <tuple>
+
+class RequestCoalescer
+{
+public:
+	struct Response
+	{
+		CURLcode result;
+		long responseCode;
+		std::string body;
+	};
+
+	class Waiter
+	{
+	public:
+		virtual ~Waiter() = default;
+
+		// Called from whichever thread finished the shared request
+		virtual void Deliver(const std::shared_ptr<const Response>& response) = 0;
+		virtual bool IsCancelled() const = 0;
+	};
+
+	enum class Role
+	{
+		Leader,// Caller sends the request, then must call Finish() with the key, whatever the outcome
+		Follower,// Waiter will be given the leader's response (possibly before Join() returns)
+		Fresh// A recent response was returned right away
+	};
+
+	// Requests are keyed on the URL and an opaque tag for how the request was set up (e.g. the options function)
+	Role Join(const std::string& url, const void* options, Waiter* waiter, std::shared_ptr<const Response>& recent);
+
+	// The body is moved into the returned response, which is what the leader reads too, so it's never copied
+	std::shared_ptr<const Response> Finish(const std::string& url, const void* options, const CURLcode& result,
+		const long& responseCode, std::string&& body);
+
+	// Cancelled waiters stop waiting for their leaders and are given an aborted response
+	void ReleaseCancelled();
+
+private:
+	static const std::chrono::steady_clock::duration freshnessWindow;
+
+	struct Key
+	{
+		std::string url;
+		const void* options;
+	};
+
+	// Lets lookups use the caller's URL without building a Key
+	struct KeyView
+	{
+		const std::string& url;
+		const void* options;
+	};
+
+	struct KeyLess
+	{
+		typedef void is_transparent;
+
+		template<typename A, typename B>
+		bool operator()(const A& a, const B& b) const { return std::tie(a.url, a.options) < std::tie(b.url, b.options); }
+	};
+
+	struct Flight
+	{
+		bool inFlight = false;
+		std::vector<Waiter*> waiters;
+
+		std::shared_ptr<const Response> response;// Only kept if successful
+		std::chrono::steady_clock::time_point completedTime;
+	};
+
+	std::mutex mutex;
+	std::map<Key, Flight, KeyLess> flights;
+
+	void RemoveStale(const std::chrono::steady_clock::time_point& now);
+};
+
+#endif// REQUEST_COALESCER_H_
@@ -0,0 +1,119 @@
+// File:  responseBufferPool.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Pool of response buffers that are reused from check to check.  Each buffer is reserved
+//        to the size its endpoint's responses usually are, so bodies are written without
+//        reallocating and steady-state polling doesn't allocate at all.
+
+// Local headers
+#include "responseBufferPool.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+const size_t ResponseBufferPool::minimumReserve(4 * 1024);
+const size_t ResponseBufferPool::reserveGranularity(4 * 1024);
+const size_t ResponseBufferPool::maxIdleBuffers(64);
+
+ResponseBufferPool::Buffer::Buffer(ResponseBufferPool& pool, std::string_view endpoint, std::string&& data)
+	: pool(&pool), endpoint(endpoint), data(std::move(data))
+{
+}
+
+ResponseBufferPool::Buffer::Buffer(Buffer&& b) noexcept : pool(b.pool), endpoint(b.endpoint), data(std::move(b.data)), takenSize(b.takenSize)
+{
+	b.pool = nullptr;
+}
+
+ResponseBufferPool::Buffer::~Buffer()
+{
+	if (!pool)
+		return;
+
+	const size_t usedSize(std::max(data.size(), takenSize));
+	pool->Release(endpoint, std::move(data), usedSize);
+}
+
+std::string ResponseBufferPool::Buffer::Take()
+{
+	takenSize = std::max(takenSize, data.size());
+	return std::move(data);
+}
+
+ResponseBufferPool::Buffer ResponseBufferPool::Acquire(std::string_view endpoint)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it(expectedSizes.find(endpoint));
+	if (it == expectedSizes.end())
+		it = expectedSizes.emplace(std::string(endpoint), minimumReserve).first;
+
+	// Reserve in fixed steps with some headroom, so sizes that wobble a little keep hitting the same allocation
+	const size_t expected(it->second + it->second / 4);
+	const size_t reserve((expected + reserveGranularity - 1) / reserveGranularity * reserveGranularity);
+
+	std::string data;
+	if (!idleBuffers.empty())
+	{
+		// Prefer the smallest idle buffer that's already big enough
+		auto best(idleBuffers.end());
+		for (auto b = idleBuffers.begin(); b != idleBuffers.end(); ++b)
+		{
+			if (b->capacity() >= reserve && (best == idleBuffers.end() || b->capacity() < best->capacity()))
+				best = b;
+		}
+
+		if (best == idleBuffers.end())
+			best = std::max_element(idleBuffers.begin(), idleBuffers.end(),
+				[](const std::string& a, const std::string& b) { return a.capacity() < b.capacity(); });
+
+		std::iter_swap(best, idleBuffers.end() - 1);
+		data = std::move(idleBuffers.back());
+		idleBuffers.pop_back();
+	}
+
+	data.clear();
+	data.reserve(reserve);
+	return Buffer(*this, it->first, std::move(data));
+}
+
+void ResponseBufferPool::Release(std::string_view endpoint, std::string&& data, const size_t& usedSize)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it(expectedSizes.find(endpoint));
+	if (it != expectedSizes.end())
+		it->second = std::max(std::max(usedSize, it->second - it->second / 16), minimumReserve);
+
+	if (idleBuffers.size() < maxIdleBuffers)
+		idleBuffers.push_back(std::move(data));
+}
+
+void ResponseBufferPool::Save(SnapshotWriter& writer) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	writer.Write(static_cast<unsigned int>(expectedSizes.size()));
+	for (const auto& size : expectedSizes)
+	{
+		writer.Write(size.first);
+		writer.Write(static_cast<unsigned long long>(size.second));
+	}
+}
+
+bool ResponseBufferPool::Load(SnapshotReader& reader)
+{
+	unsigned int count;
+	if (!reader.Read(count))
+		return false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		std::string endpoint;
+		unsigned long long size;
+		if (!reader.Read(endpoint) || !reader.Read(size))
+			return false;
+
+		expectedSizes[endpoint] = static_cast<size_t>(size);
+	}
+
+	return true;
+}
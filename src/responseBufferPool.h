@@ -0,0 +1,71 @@
+// File:  responseBufferPool.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Pool of response buffers that are reused from check to check.  Each buffer is reserved
+//        to the size its endpoint's responses usually are, so bodies are written without
+//        reallocating and steady-state polling doesn't allocate at all.
+
+#ifndef RESPONSE_BUFFER_POOL_H_
+#define RESPONSE_BUFFER_POOL_H_
+
+// Local headers
+#include "snapshot.h"
+
+// Standard C++ headers
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <mutex>
+
+class ResponseBufferPool
+{
+public:
+	// Returns the string to the pool when it goes out of scope; pass the string itself (*buffer) to Get() and parsers
+	class Buffer
+	{
+	public:
+		Buffer(Buffer&& b) noexcept;
+		Buffer(const Buffer&) = delete;
+		Buffer& operator=(const Buffer&) = delete;
+		Buffer& operator=(Buffer&&) = delete;
+		~Buffer();
+
+		std::string& operator*() { return data; }
+		std::string* operator->() { return &data; }
+
+		// Moves the contents out (e.g. into a shared response); their size still counts toward the endpoint's usual size
+		std::string Take();
+
+	private:
+		friend class ResponseBufferPool;
+		Buffer(ResponseBufferPool& pool, std::string_view endpoint, std::string&& data);
+
+		ResponseBufferPool* pool;
+		std::string_view endpoint;// Points into the pool's size map
+		std::string data;
+		size_t takenSize = 0;
+	};
+
+	// Thread-safe
+	Buffer Acquire(std::string_view endpoint);
+
+	// Only the learned sizes are saved; buffers are allocated again as they're needed
+	void Save(SnapshotWriter& writer) const;
+	bool Load(SnapshotReader& reader);
+
+private:
+	static const size_t minimumReserve;
+	static const size_t reserveGranularity;
+	static const size_t maxIdleBuffers;
+
+	mutable std::mutex mutex;
+	std::vector<std::string> idleBuffers;
+
+	// Largest recent body for each endpoint; decays slowly so one huge response doesn't pin memory forever
+	std::map<std::string, size_t, std::less<>> expectedSizes;
+
+	void Release(std::string_view endpoint, std::string&& data, const size_t& usedSize);
+};
+
+#endif// RESPONSE_BUFFER_POOL_H_
@@ -7,7 +7,14 @@
 #include "riteAidTarget.h"
 #include "email/curlUtilities.h"
 
-const std::string RiteAidTarget::cookieFile(".riteAidCookies");
+// Standard C++ headers
+#include <algorithm>
+
+const std::string RiteAidTarget::defaultURL("https://www.riteaid.com/pharmacy/apt-scheduler#");
+const double RiteAidTarget::hitRateWeight(0.2);
+const double RiteAidTarget::stalenessWeight(0.05);
+const unsigned int RiteAidTarget::searchRadius(50);
+const unsigned int RiteAidTarget::storesPerQuery(10);
 
 RiteAidTarget::~RiteAidTarget()
 {
@@ -15,26 +22,40 @@ RiteAidTarget::~RiteAidTarget()
 		curl_slist_free_all(headerList);
 }
 
-bool RiteAidTarget::AppointmentsAvailable(std::string& message)
+// Hits are reported per store as they're found, so there's no message to return
+Task<bool> RiteAidTarget::AppointmentsAvailable(std::string&)
 {
-	// Get base page (always do this to keep cookies current)
-	std::string response;
-	if (!DoCURLGet(url, response, SetOptions))
+	// Get base page (only when needed to keep cookies current)
+	if (SessionNeedsRefresh())
 	{
-		SendLogMessage("Rite Aid get failed");
-		return false;
+		auto page(GetResponseBuffer(url));
+		if (!co_await Get(url, *page, SetOptions))
+		{
+			SendLogMessage("Rite Aid get failed");
+			co_return false;
+		}
+		SessionRefreshed();
 	}
 
-	const auto now(std::chrono::system_clock::now());
-	if (cachedLocations.empty() || cacheUpdatedTime + std::chrono::hours(24) > now)
+	const auto statusAccess(GetEndpointAccess(statusEndpointURL));
+	if (statusAccess == EndpointHealth::Access::Skip)
+		co_return false;
+
+	// A stale cache is better than none while the store finder is demoted
+	const auto now(Now());
+	if (cachedLocations.empty() || cacheUpdatedTime + std::chrono::hours(24) < now)
 	{
-		if (!UpdateCachedLocations())
-			return false;
+		if (GetEndpointAccess(findStoresEndpointURL) != EndpointHealth::Access::Skip)
+		{
+			if (!co_await UpdateCachedLocations())
+				co_return false;
+			cacheUpdatedTime = now;
+		}
+		else if (cachedLocations.empty())
+			co_return false;
 	}
 
-	// Find stores - only returns 10 nearest locations, so need to check multiple locations to be thorough
-	bool available(false);
-	std::ostringstream messageSS;
+	std::vector<Location*> storesToCheck;
 	for (auto& store : cachedLocations)
 	{
 		if (store.postponeChecking)
@@ -45,241 +66,361 @@ bool RiteAidTarget::AppointmentsAvailable(std::string& message)
 				continue;
 		}
 
-		RefererData d;
-		d.referer = UString::ToNarrowString(url);
-		
-		// Check availability
-		// This goes fast enough that it's not worth trying to notify users faster - check all locations then send one notification
-		if (!DoCURLGet(GetStatusCheckURL(store.storeNumber), response, SetOptionsWithReferer, &d))
-		{
-			SendLogMessage("Rite Aid check status failed");
-			return false;
-		}
+		storesToCheck.push_back(&store);
+	}
 
-		bool locationHasAvailability;
-		if (!ParseStatus(response, locationHasAvailability))
-			continue;
+	// Requests go out in this order, so stores most likely to have openings are checked (and reported) first
+	std::sort(storesToCheck.begin(), storesToCheck.end(), [this, &now](const Location* a, const Location* b)
+	{
+		return GetCheckPriority(*a, now) > GetCheckPriority(*b, now);
+	});
 
-		if (locationHasAvailability)
-		{
-			store.postponeChecking = true;
-			store.postponedUntil = now + checkPeriod * 10;
-			available = true;
+	// One store is enough to tell whether a demoted status endpoint has recovered
+	if (statusAccess == EndpointHealth::Access::Probe && storesToCheck.size() > 1)
+		storesToCheck.resize(1);
 
-			messageSS << "Rite Aid Location Info:  " << UString::ToNarrowString(store.address) << ", "
-				<< UString::ToNarrowString(store.city) << ", " << UString::ToNarrowString(store.state) << " " << UString::ToNarrowString(store.zip) << '\n';
-		}
-	}
+	// Check availability
+	// All stores are requested at once (multiplexed over one connection when the server allows it), and each hit is reported as soon as it's found
+	std::vector<Task<bool>> checks;
+	for (auto& store : storesToCheck)
+		checks.push_back(CheckStore(*store, now));
+	const auto results(co_await WhenAll(std::move(checks)));
 
-	message = messageSS.str();
-	return available;
+	co_return std::find(results.begin(), results.end(), true) != results.end();
 }
 
-bool RiteAidTarget::UpdateCachedLocations()
+Task<bool> RiteAidTarget::CheckStore(Location& store, const std::chrono::system_clock::time_point& now)
 {
-	cachedLocations.clear();
-	for (const auto& loc : locations)// Go through user-specified locations to check
+	auto response(GetResponseBuffer(store.statusURL));
+	SharedResponse status;
+	if (!co_await GetShared(store.statusURL, response, status, SetOptionsWithReferer, &refererData))
 	{
-		RefererData d;
-		std::string response;
-		d.referer = UString::ToNarrowString(url);
-		if (!DoCURLGet(GetFindStoresURL(loc), response, SetOptionsWithReferer, &d))
+		SendLogMessage("Rite Aid check status failed");
+		co_return false;
+	}
+
+	bool locationHasAvailability;
+	if (!ParseStatus(store.statusURL, status->body, locationHasAvailability))
+		co_return false;
+
+	// Status sometimes flips to available for a moment; ask again (ahead of the other stores) before believing it
+	if (locationHasAvailability)
+	{
+		if (!co_await Confirm(store.statusURL, *response, SetOptionsWithReferer, &refererData))
 		{
-			SendLogMessage("Rite Aid get stores failed");
-			return false;
+			SendLogMessage("Rite Aid confirm status failed");
+			co_return false;
 		}
 
-		std::vector<Location> data;
-		if (!ParseLocations(response, data))
-			continue;
+		if (!ParseStatus(store.statusURL, *response, locationHasAvailability))
+			co_return false;
 
-		for (const auto& newLocation : data)
-		{
-			bool alreadyCached(false);
-			for (const auto& c : cachedLocations)
-			{
-				if (c.storeNumber == newLocation.storeNumber)
-				{
-					alreadyCached = true;
-					break;
-				}
-			}
+		if (!locationHasAvailability)
+			SendLogMessage("Rite Aid store " + std::to_string(store.storeNumber) + " availability not confirmed");
+	}
 
-			if (!alreadyCached)
-				cachedLocations.push_back(newLocation);
-		}
+	store.lastChecked = now;
+	store.hitRate = store.hitRate * (1.0 - hitRateWeight) + (locationHasAvailability ? hitRateWeight : 0.0);
+	PublishAvailability(store.subscriptionLocation, locationHasAvailability);
+
+	if (locationHasAvailability)
+	{
+		store.postponeChecking = true;
+		store.postponedUntil = now + checkPeriod * timingPolicy.postponePeriods;
+		ReportAppointments(store.description);
 	}
 
-	return true;
+	co_return locationHasAvailability;
 }
 
-UString::String RiteAidTarget::GetFindStoresURL(const UString::String& location)
+// Search settings come first, so a snapshot taken with different areas is recognized and ignored
+void RiteAidTarget::SaveState(SnapshotWriter& writer) const
 {
-	return _T("https://www.riteaid.com/services/ext/v2/stores/getStores?address=") + location + _T("&attrFilter=PREF-112&fetchMechanismVersion=2&radius=50");
-}
+	FinderTarget::SaveState(writer);
 
-UString::String RiteAidTarget::GetStatusCheckURL(const unsigned int& storeNumber)
-{
-	UString::OStringStream ss;
-	ss << "https://www.riteaid.com/services/ext/v2/vaccine/checkSlots?storeNumber=" << storeNumber;
-	return ss.str();
+	writer.Write(static_cast<unsigned int>(locations.size()));
+	for (const auto& l : locations)
+		writer.Write(l);
+	writer.Write(phillyMode);
+
+	writer.Write(cacheUpdatedTime);
+	writer.Write(static_cast<unsigned int>(cachedLocations.size()));
+	for (const auto& c : cachedLocations)
+	{
+		writer.Write(c.storeNumber);
+		writer.Write(c.address);
+		writer.Write(c.city);
+		writer.Write(c.state);
+		writer.Write(c.zip);
+		writer.Write(c.hasPosition);
+		writer.Write(c.latitude);
+		writer.Write(c.longitude);
+		writer.Write(c.milesFromCenter);
+		writer.Write(c.postponeChecking);
+		writer.Write(c.postponedUntil);
+		writer.Write(c.hitRate);
+		writer.Write(c.lastChecked);
+	}
+
+	discoveryPlanner.Save(writer);
 }
 
-bool RiteAidTarget::SetOptions(CURL* curl, const ModificationData*)
+bool RiteAidTarget::LoadState(SnapshotReader& reader)
 {
-	// This is required for multi-threaded applications
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L), _T("Failed to disable signaling")))
+	if (!FinderTarget::LoadState(reader))
 		return false;
 
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L), _T("Failed to enable location following")))
+	unsigned int count;
+	if (!reader.Read(count))
 		return false;
 
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_COOKIEFILE, cookieFile.c_str()), _T("Failed to load the cookie file")))
+	std::vector<std::string> savedLocations(count);
+	for (auto& l : savedLocations)
+	{
+		if (!reader.Read(l))
+			return false;
+	}
+
+	bool savedPhillyMode;
+	if (!reader.Read(savedPhillyMode))
 		return false;
 
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_COOKIEJAR, cookieFile.c_str()), _T("Failed to enable saving cookies")))
+	if (savedLocations != locations || savedPhillyMode != phillyMode)
+		return true;// Different search; start over
+
+	std::chrono::system_clock::time_point savedUpdateTime;
+	if (!reader.Read(savedUpdateTime) || !reader.Read(count))
 		return false;
 
-	return true;
-}
+	std::vector<Location> savedCache(count);
+	for (auto& c : savedCache)
+	{
+		if (!reader.Read(c.storeNumber) ||
+			!reader.Read(c.address) ||
+			!reader.Read(c.city) ||
+			!reader.Read(c.state) ||
+			!reader.Read(c.zip) ||
+			!reader.Read(c.hasPosition) ||
+			!reader.Read(c.latitude) ||
+			!reader.Read(c.longitude) ||
+			!reader.Read(c.milesFromCenter) ||
+			!reader.Read(c.postponeChecking) ||
+			!reader.Read(c.postponedUntil) ||
+			!reader.Read(c.hitRate) ||
+			!reader.Read(c.lastChecked))
+			return false;
 
-bool RiteAidTarget::SetOptionsWithReferer(CURL* curl, const ModificationData* data)
-{
-	SetOptions(curl, nullptr);
-	auto referer(reinterpret_cast<const RefererData*>(data));
-	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_REFERER, referer->referer.c_str()), _T("Failed to set referer")))
+		c.statusURL = GetStatusCheckURL(c.storeNumber);
+		c.description = GetDescription(c);
+		c.subscriptionLocation = GetSubscriptionLocation(c);
+	}
+
+	if (!discoveryPlanner.Load(reader))
 		return false;
 
+	cacheUpdatedTime = savedUpdateTime;
+	cachedLocations.swap(savedCache);
 	return true;
 }
 
-bool RiteAidTarget::ParseLocations(const std::string& response, std::vector<Location>& data) const
+void RiteAidTarget::AddStatus(cJSON* status) const
 {
-	cJSON* root(cJSON_Parse(response.c_str()));
-	if (!root)
-	{
-		Cerr << "Failed to parse root node\n";
-		return false;
-	}
+	cJSON_AddNumberToObject(status, "cacheUpdated", ToUnixTime(cacheUpdatedTime));
+	cJSON_AddStringToObject(status, "discovery", discoveryPlanner.GetSummary().c_str());
 
-	cJSON* dataObject(cJSON_GetObjectItem(root, "Data"));
-	if (!dataObject)
+	cJSON* stores(cJSON_AddArrayToObject(status, "stores"));
+	for (const auto& c : cachedLocations)
 	{
-		Cerr << "Failed to get data object\n";
-		cJSON_Delete(root);
-		return false;
+		cJSON* store(cJSON_CreateObject());
+		cJSON_AddNumberToObject(store, "storeNumber", c.storeNumber);
+		cJSON_AddStringToObject(store, "description", c.description.c_str());
+		cJSON_AddNumberToObject(store, "hitRate", c.hitRate);
+		cJSON_AddNumberToObject(store, "lastChecked", ToUnixTime(c.lastChecked));
+		if (c.postponeChecking)
+			cJSON_AddNumberToObject(store, "postponedUntil", ToUnixTime(c.postponedUntil));
+		cJSON_AddItemToArray(stores, store);
 	}
+}
+
+FinderTarget::UpcomingRequests RiteAidTarget::GetUpcomingRequests(const std::chrono::system_clock::time_point& checkTime) const
+{
+	if (cachedLocations.empty())
+		return UpcomingRequests{ url, 1, SetOptions };
 
-	cJSON* storeArray(cJSON_GetObjectItem(dataObject, "stores"));
-	if (!storeArray)
+	// Every store's status comes from the same host, and they're all requested at once (nothing is sent if they're all postponed)
+	const auto dueCount(std::count_if(cachedLocations.begin(), cachedLocations.end(), [&checkTime](const Location& store)
 	{
-		Cerr << "Failed to get stores array\n";
-		cJSON_Delete(root);
-		return false;
-	}
+		return !store.postponeChecking || checkTime > store.postponedUntil;
+	}));
+
+	if (dueCount == 0)
+		return UpcomingRequests();
+	return UpcomingRequests{ cachedLocations.front().statusURL, static_cast<unsigned int>(dueCount), SetOptionsWithReferer, &refererData };
+}
 
-	for (int i = 0; i < cJSON_GetArraySize(storeArray); ++i)
+// Recent hit rate dominates; among stores with similar rates, the one that has gone longest without a check wins
+double RiteAidTarget::GetCheckPriority(const Location& store, const std::chrono::system_clock::time_point& now) const
+{
+	const double periodsSinceCheck(std::chrono::duration<double>(now - store.lastChecked) / checkPeriod);
+	return store.hitRate + stalenessWeight * std::min(periodsSinceCheck, 10.0);
+}
+
+Task<bool> RiteAidTarget::UpdateCachedLocations()
+{
+	// Find stores - only returns the nearest few locations, so it takes several queries to be thorough.  The planner
+	// skips queries that would only repeat others, and asks for more where a result was cut off.
+	std::vector<Location> foundLocations;
+	auto queries(discoveryPlanner.Plan());
+	while (!queries.empty())
 	{
-		cJSON* item(cJSON_GetArrayItem(storeArray, i));
-		if (!item)
-		{
-			Cerr << "Failed to get stores object\n";
-			cJSON_Delete(root);
-			return false;
-		}
+		// Queries in a round are independent, so do them all at once
+		std::vector<std::vector<Location>> queryLocations(queries.size());
+		std::vector<Task<bool>> lookups;
+		for (unsigned int i = 0; i < queries.size(); ++i)
+			lookups.push_back(FindStores(queries[i], queryLocations[i]));
 
-		Location loc;
-		if (!ReadJSON(item, _T("storeNumber"), loc.storeNumber))
-		{
-			Cerr << "Failed to read store number\n";
-			cJSON_Delete(root);
-			return false;
-		}
+		const auto results(co_await WhenAll(std::move(lookups)));
+		if (std::find(results.begin(), results.end(), false) != results.end())
+			co_return false;
 
-		if (!ReadJSON(item, _T("address"), loc.address))
+		for (unsigned int i = 0; i < queries.size(); ++i)
 		{
-			Cerr << "Failed to read address\n";
-			cJSON_Delete(root);
-			return false;
-		}
+			std::vector<StoreDiscoveryPlanner::Store> stores;
+			for (const auto& location : queryLocations[i])
+			{
+				StoreDiscoveryPlanner::Store store;
+				store.number = location.storeNumber;
+				store.zip = location.zip;
+				store.hasPosition = location.hasPosition;
+				store.latitude = location.latitude;
+				store.longitude = location.longitude;
+				store.distance = location.milesFromCenter;
+				stores.push_back(store);
+
+				if (IsInSearchArea(location, phillyMode))
+					foundLocations.push_back(location);
+			}
 
-		if (!ReadJSON(item, _T("city"), loc.city))
-		{
-			Cerr << "Failed to read city\n";
-			cJSON_Delete(root);
-			return false;
+			discoveryPlanner.Record(queries[i], stores);
 		}
 
-		if (!ReadJSON(item, _T("state"), loc.state))
-		{
-			Cerr << "Failed to read state\n";
-			cJSON_Delete(root);
-			return false;
-		}
+		queries = discoveryPlanner.PlanFollowUps();
+	}
+
+	SendLogMessage(discoveryPlanner.GetSummary());
+
+	// Stores reached only by queries that were skipped this time are still there; full sweeps catch stores that have gone away
+	if (!discoveryPlanner.WasFullSweep())
+		foundLocations.insert(foundLocations.end(), cachedLocations.begin(), cachedLocations.end());
 
-		if (!ReadJSON(item, _T("zipcode"), loc.zip))
+	// Keep history (hit rate, postponement) for stores we already knew about
+	std::vector<Location> previousLocations;
+	previousLocations.swap(cachedLocations);
+	for (const auto& newLocation : foundLocations)
+	{
+		bool alreadyCached(false);
+		for (const auto& c : cachedLocations)
 		{
-			Cerr << "Failed to read zip code\n";
-			cJSON_Delete(root);
-			return false;
+			if (c.storeNumber == newLocation.storeNumber)
+			{
+				alreadyCached = true;
+				break;
+			}
 		}
 
-		if (loc.state != UString::String(_T("PA")))
-			return true;
+		if (alreadyCached)
+			continue;
 
-		if ((phillyMode && loc.city == UString::String(_T("Philadelphia"))) ||
-			(!phillyMode && loc.city != UString::String(_T("Philadelphia"))))
-			data.push_back(loc);
+		cachedLocations.push_back(newLocation);
+		for (const auto& p : previousLocations)
+		{
+			if (p.storeNumber == newLocation.storeNumber)
+			{
+				cachedLocations.back().postponeChecking = p.postponeChecking;
+				cachedLocations.back().postponedUntil = p.postponedUntil;
+				cachedLocations.back().hitRate = p.hitRate;
+				cachedLocations.back().lastChecked = p.lastChecked;
+				break;
+			}
+		}
 	}
 
-	return true;
+	co_return true;
 }
 
-bool RiteAidTarget::ParseStatus(const std::string& response, bool& available)
+Task<bool> RiteAidTarget::FindStores(const std::string& location, std::vector<Location>& data)
 {
-	cJSON* root(cJSON_Parse(response.c_str()));
-	if (!root)
+	const std::string findStoresURL(GetFindStoresURL(location));
+	auto response(GetResponseBuffer(findStoresURL));
+	SharedResponse stores;
+	if (!co_await GetShared(findStoresURL, response, stores, SetOptionsWithReferer, &refererData))
 	{
-		Cerr << "Failed to parse root node\n";
-		return false;
+		SendLogMessage("Rite Aid get stores failed");
+		co_return false;
 	}
 
-	cJSON* dataObject(cJSON_GetObjectItem(root, "Data"));
-	if (!dataObject)
-	{
-		Cerr << "Failed to get data object\n";
-		cJSON_Delete(root);
+	// On failure, just skip this area
+	unsigned int recordCount, skippedCount;
+	if (ParseLocations(stores->body, data, recordCount, skippedCount))
+		RecordParsed(findStoresURL, recordCount, skippedCount);
+	else
+		RecordParseFailure(findStoresURL);
+
+	for (auto& store : data)
+		store.subscriptionLocation = GetSubscriptionLocation(store);
+
+	co_return true;
+}
+
+std::string RiteAidTarget::GetFindStoresURL(const std::string& location)
+{
+	return "https://www.riteaid.com/services/ext/v2/stores/getStores?address=" + location + "&attrFilter=PREF-112&fetchMechanismVersion=2&radius=" + std::to_string(searchRadius);
+}
+
+SubscriptionEngine::Location RiteAidTarget::GetSubscriptionLocation(const Location& store) const
+{
+	SubscriptionEngine::Location location;
+	location.target = name;
+	location.id = std::to_string(store.storeNumber);
+	location.description = "#" + location.id + ' ' + store.address + ", " + store.city + ", " + store.state + ' ' + store.zip;
+	location.city = store.city;
+	location.state = store.state;
+	location.hasPosition = store.hasPosition;
+	location.latitude = store.latitude;
+	location.longitude = store.longitude;
+	return location;
+}
+
+bool RiteAidTarget::SetOptions(CURL* curl, const ModificationData*)
+{
+	// This is required for multi-threaded applications
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L), _T("Failed to disable signaling")))
 		return false;
-	}
 
-	cJSON* slots(cJSON_GetObjectItem(dataObject, "slots"));
-	if (!slots)
-	{
-		Cerr << "Failed to get slots object\n";
-		cJSON_Delete(root);
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L), _T("Failed to enable location following")))
 		return false;
-	}
 
-	// Not sure what the difference is between one and two?  First/second dose availability?
-	bool one, two;
-	if (!ReadJSON(slots, _T("1"), one))
-	{
-		Cerr << "Failed to read one\n";
-		cJSON_Delete(root);
+	return true;
+}
+
+bool RiteAidTarget::SetOptionsWithReferer(CURL* curl, const ModificationData* data)
+{
+	SetOptions(curl, nullptr);
+	auto referer(reinterpret_cast<const RefererData*>(data));
+	if (CURLUtilities::CURLCallHasError(curl_easy_setopt(curl, CURLOPT_REFERER, referer->referer.c_str()), _T("Failed to set referer")))
 		return false;
-	}
 
-	if (!ReadJSON(slots, _T("2"), two))
+	return true;
+}
+
+bool RiteAidTarget::ParseStatus(const std::string& requestURL, const std::string& response, bool& available)
+{
+	if (!ParseStatus(response, available))
 	{
-		Cerr << "Failed to read two\n";
-		cJSON_Delete(root);
+		RecordParseFailure(requestURL);
 		return false;
 	}
 
-	available = one || two;
-	/*if (available)// Until we understand one/two, provide additional diagnostics
-	// I still don't understand 100%, but I have not yet seen a response different from 1:true,2:false, so we'll ignore this for now 3/6/2021
-		Cout << "one:  " << static_cast<int>(one) << "; two:  " << static_cast<int>(two) << std::endl;*/
-
+	RecordParsed(requestURL, 1, 0);
 	return true;
 }
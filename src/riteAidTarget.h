@@ -8,56 +8,105 @@
 
 // Local headers
 #include "finderTarget.h"
+#include "storeDiscoveryPlanner.h"
 
 class RiteAidTarget : public FinderTarget
 {
 public:
-	RiteAidTarget(const UString::String& url, MainFrame* mainFrame, const std::vector<UString::String>& locations,
-		const unsigned int& checkPeriod, const bool& phillyMode) : FinderTarget(url, mainFrame,
-			checkPeriod, _T("Rite Aid")), locations(locations), phillyMode(phillyMode) {}
+	RiteAidTarget(const std::string& url, MainFrame* mainFrame, FetchEngine* fetchEngine, const std::vector<std::string>& locations,
+		const unsigned int& checkPeriod, const bool& phillyMode) : FinderTarget(url, mainFrame, fetchEngine,
+			checkPeriod, "Rite Aid", ".riteAidCookies"), locations(locations), phillyMode(phillyMode),
+			discoveryPlanner(locations, searchRadius, storesPerQuery), statusEndpointURL(GetStatusCheckURL(0)),
+			findStoresEndpointURL(GetFindStoresURL(std::string())) { refererData.referer = url; }
 	~RiteAidTarget();
 
+	static const std::string defaultURL;
+
+	struct Location
+	{
+		unsigned int storeNumber;
+		std::string address;
+		std::string city;
+		std::string state;
+		std::string zip;
+
+		bool hasPosition = false;
+		double latitude = 0.0;// [deg]
+		double longitude = 0.0;// [deg]
+		double milesFromCenter = 0.0;// Of the query that found it
+
+		// Built once when the cache is filled so checks don't need to format anything
+		std::string statusURL;
+		std::string description;
+		SubscriptionEngine::Location subscriptionLocation;// Filled in by the target, which knows its name
+
+		bool postponeChecking = false;
+		std::chrono::system_clock::time_point postponedUntil;
+
+		// Used to decide which stores to check first
+		double hitRate = 0.0;// Exponentially weighted fraction of recent checks that found availability
+		std::chrono::system_clock::time_point lastChecked;
+	};
+
+	// These don't touch the UI, so they can be exercised without a running application
+	// ParseLocations returns every store, including ones we won't check; stores missing a field are skipped (and counted)
+	static bool ParseLocations(const std::string& response, std::vector<Location>& data, unsigned int& recordCount, unsigned int& skippedCount);
+	static bool IsInSearchArea(const Location& location, const bool& phillyMode);
+	static bool ParseStatus(const std::string& response, bool& available);
+
+	bool IsDemoted() const override { return IsEndpointDemoted(statusEndpointURL); }
+
 protected:
-	bool AppointmentsAvailable(std::string& message) override;
+	Task<bool> AppointmentsAvailable(std::string& message) override;
 
 	State DoFoundAppointmentStateChange() const override { return State::NormalCheck; }
 
+	void SaveState(SnapshotWriter& writer) const override;
+	bool LoadState(SnapshotReader& reader) override;
+	void AddStatus(cJSON* status) const override;
+	UpcomingRequests GetUpcomingRequests(const std::chrono::system_clock::time_point& checkTime) const override;
+
 private:
-	const std::vector<UString::String> locations;
+	const std::vector<std::string> locations;
 	const bool phillyMode;
 
+	// The store finder returns at most storesPerQuery stores within searchRadius [miles] of the address
+	static const unsigned int searchRadius;
+	static const unsigned int storesPerQuery;
+	StoreDiscoveryPlanner discoveryPlanner;
+
+	// Any request to an endpoint stands for all of them in its health record; built once so checks don't format them
+	const std::string statusEndpointURL;
+	const std::string findStoresEndpointURL;
+
 	struct RefererData : public ModificationData
 	{
 		std::string referer;
 	};
 
+	RefererData refererData;
+
 	static bool SetOptions(CURL* curl, const ModificationData*);
 	static bool SetOptionsWithReferer(CURL* curl, const ModificationData* data);
 
-	static UString::String GetFindStoresURL(const UString::String& location);
-	static UString::String GetStatusCheckURL(const unsigned int& storeNumber);
+	static std::string GetFindStoresURL(const std::string& location);
+	static std::string GetStatusCheckURL(const unsigned int& storeNumber);
+	static std::string GetDescription(const Location& location);
+	SubscriptionEngine::Location GetSubscriptionLocation(const Location& store) const;
 
-	static const std::string cookieFile;
 	struct curl_slist* headerList = nullptr;
 
-	struct Location
-	{
-		unsigned int storeNumber;
-		UString::String address;
-		UString::String city;
-		UString::String state;
-		UString::String zip;
-
-		bool postponeChecking = false;
-		std::chrono::system_clock::time_point postponedUntil;
-	};
+	static const double hitRateWeight;
+	static const double stalenessWeight;
+	double GetCheckPriority(const Location& store, const std::chrono::system_clock::time_point& now) const;
 
 	std::vector<Location> cachedLocations;
 	std::chrono::system_clock::time_point cacheUpdatedTime;
-	bool UpdateCachedLocations();
+	Task<bool> UpdateCachedLocations();
+	Task<bool> FindStores(const std::string& location, std::vector<Location>& data);
+	Task<bool> CheckStore(Location& store, const std::chrono::system_clock::time_point& now);
+	bool ParseStatus(const std::string& requestURL, const std::string& response, bool& available);
 
-	bool ParseLocations(const std::string& response, std::vector<Location>& data) const;
-	static bool ParseStatus(const std::string& response, bool& available);
 };
 
 #endif// RITE_AID_TARGET_H_
@@ -0,0 +1,394 @@
+// File:  simulator.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Replays a recorded timeline of responses against a target on a virtual clock, so
+//        check timing policies can be compared (detection latency vs. request volume) in
+//        seconds instead of days and without touching the real sites.
+
+// Local headers
+#include "simulator.h"
+#include "cvsTarget.h"
+#include "jeffersonTarget.h"
+#include "riteAidTarget.h"
+#include "utilities/uString.h"
+
+// Standard C++ headers
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+const std::chrono::seconds Simulator::defaultDuration(std::chrono::hours(24));
+
+bool Simulator::Load(const std::string& timelineFileName)
+{
+	std::ifstream file(timelineFileName);
+	if (!file.is_open())
+	{
+		Cerr << "Failed to open timeline '" << UString::ToStringType(timelineFileName) << "'\n";
+		return false;
+	}
+
+	const auto slash(timelineFileName.find_last_of("/\\"));
+	const std::string directory(slash == std::string::npos ? std::string() : timelineFileName.substr(0, slash + 1));
+
+	std::string line;
+	unsigned int lineNumber(0);
+	bool haveEnd(false);
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+		line = line.substr(0, line.find('#'));
+
+		std::istringstream ss(line);
+		std::string keyword;
+		if (!(ss >> keyword))
+			continue;
+
+		bool ok(true);
+		if (keyword == "target")
+		{
+			std::string type;
+			ss >> type;
+			if (type == "cvs")
+			{
+				targetType = TargetType::CVS;
+				std::string exclude;
+				if (ss >> exclude)
+					targetLocations = Split(exclude, ';');
+			}
+			else if (type == "jefferson")
+				targetType = TargetType::Jefferson;
+			else if (type == "riteaid")
+			{
+				targetType = TargetType::RiteAid;
+				std::string locations;
+				ok = static_cast<bool>(ss >> phillyMode >> locations);
+				targetLocations = Split(locations, ';');
+			}
+			else
+				ok = false;
+		}
+		else if (keyword == "response")
+		{
+			long long time;
+			std::string url, bodyFileName;
+			ok = static_cast<bool>(ss >> time >> url >> bodyFileName);
+			if (ok)
+			{
+				std::ifstream bodyFile(directory + bodyFileName, std::ios::binary);
+				if (!bodyFile.is_open())
+				{
+					Cerr << "Failed to open response body '" << UString::ToStringType(directory + bodyFileName) << "'\n";
+					return false;
+				}
+
+				std::ostringstream body;
+				body << bodyFile.rdbuf();
+
+				TimedResponse response;
+				response.time = std::chrono::seconds(time);
+				response.body = std::make_shared<const std::string>(body.str());
+				if (!url.empty() && url.back() == '*')
+					prefixResponses[url.substr(0, url.length() - 1)].push_back(response);
+				else
+					responses[url].push_back(response);
+			}
+		}
+		else if (keyword == "opening")
+		{
+			long long start, length;
+			ok = static_cast<bool>(ss >> start >> length);
+			if (ok)
+				openings.push_back(Opening{std::chrono::seconds(start), std::chrono::seconds(length)});
+		}
+		else if (keyword == "end")
+		{
+			long long end;
+			ok = static_cast<bool>(ss >> end);
+			duration = std::chrono::seconds(end);
+			haveEnd = true;
+		}
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			Cerr << "Failed to parse timeline line " << lineNumber << ": " << UString::ToStringType(line) << '\n';
+			return false;
+		}
+	}
+
+	const auto byTime([](const TimedResponse& a, const TimedResponse& b) { return a.time < b.time; });
+	for (auto& r : responses)
+		std::stable_sort(r.second.begin(), r.second.end(), byTime);
+	for (auto& r : prefixResponses)
+		std::stable_sort(r.second.begin(), r.second.end(), byTime);
+
+	if (!haveEnd)
+		duration = defaultDuration;
+
+	return true;
+}
+
+std::vector<Simulator::Policy> Simulator::GetPolicyGrid() const
+{
+	const FinderTarget::TimingPolicy defaults;
+	const std::vector<unsigned int> checkPeriods({ 60, 120, 300, 600 });
+	const std::vector<unsigned int> followUpDivisors({ 1, 2, 4, 8 });
+	std::vector<unsigned int> postponePeriods({ defaults.postponePeriods });
+	if (targetType == TargetType::RiteAid)
+		postponePeriods = { 0, 5, 10, 20 };
+
+	std::vector<Policy> policies;
+	for (const auto& period : checkPeriods)
+	{
+		for (const auto& divisor : followUpDivisors)
+		{
+			for (const auto& postpone : postponePeriods)
+			{
+				Policy policy;
+				policy.checkPeriod = period;
+				policy.timing = defaults;
+				policy.timing.followUpPeriodDivisor = divisor;
+				policy.timing.postponePeriods = postpone;
+				policies.push_back(policy);
+			}
+		}
+	}
+
+	return policies;
+}
+
+Simulator::Result Simulator::Run(const Policy& policy) const
+{
+	const auto runStart(std::chrono::steady_clock::now());
+
+	// Whole seconds keep the target's time arithmetic free of rounding surprises
+	const auto start(std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now()));
+	Replay replay(*this, start);
+
+	auto target(CreateTarget(policy.checkPeriod));
+	target->SetSimulation(replay);
+	target->SetTimingPolicy(policy.timing);
+	target->BeginCheckLoop();
+	replay.GetVirtualClock().WaitForEnd();
+	target->Stop();
+	target->Join();
+
+	Result result;
+	result.policy = policy;
+	result.requestCount = replay.requestCount;
+	result.responseBytes = replay.responseBytes;
+	Evaluate(replay.hitTimes, result);
+	result.runTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+	return result;
+}
+
+// Every request is answered by the replay, so targets don't need a fetch engine
+std::unique_ptr<FinderTarget> Simulator::CreateTarget(const unsigned int& checkPeriod) const
+{
+	switch (targetType)
+	{
+	case TargetType::Jefferson:
+		return std::make_unique<JeffersonTarget>(JeffersonTarget::defaultURL, nullptr, nullptr, checkPeriod);
+
+	case TargetType::RiteAid:
+		return std::make_unique<RiteAidTarget>(RiteAidTarget::defaultURL, nullptr, nullptr, targetLocations, checkPeriod, phillyMode);
+
+	default:
+	case TargetType::CVS:
+		return std::make_unique<CVSTarget>(CVSTarget::defaultURL, nullptr, nullptr, checkPeriod, targetLocations);
+	}
+}
+
+// An opening counts as detected by the first hit reported while it was open
+void Simulator::Evaluate(const std::vector<std::chrono::seconds>& hitTimes, Result& result) const
+{
+	std::vector<double> latencies;
+	for (const auto& opening : openings)
+	{
+		const auto hit(std::lower_bound(hitTimes.begin(), hitTimes.end(), opening.start));
+		if (hit != hitTimes.end() && *hit <= opening.start + opening.duration)
+			latencies.push_back(std::chrono::duration<double>(*hit - opening.start).count());
+	}
+
+	result.openingCount = static_cast<unsigned int>(openings.size());
+	result.detectedCount = static_cast<unsigned int>(latencies.size());
+	if (latencies.empty())
+		return;
+
+	std::sort(latencies.begin(), latencies.end());
+	result.meanLatency = std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+	result.p95Latency = latencies[static_cast<size_t>(std::ceil(0.95 * latencies.size())) - 1];
+	result.maxLatency = latencies.back();
+}
+
+std::string Simulator::FormatReport(const std::vector<Result>& results) const
+{
+	const double hours(std::chrono::duration<double>(duration).count() / 3600.0);
+
+	std::ostringstream ss;
+	ss << "Simulated " << std::fixed << std::setprecision(1) << hours << " hours with " << openings.size() << " openings\n\n"
+		<< std::setw(8) << "Period" << std::setw(10) << "FollowUp" << std::setw(10) << "Postpone"
+		<< std::setw(10) << "Detected" << std::setw(10) << "Mean" << std::setw(10) << "p95" << std::setw(10) << "Max"
+		<< std::setw(10) << "Requests" << std::setw(10) << "Req/hr" << std::setw(12) << "MB" << std::setw(10) << "Run" << '\n'
+		<< std::setw(8) << "[sec]" << std::setw(10) << "[/div]" << std::setw(10) << "[periods]"
+		<< std::setw(10) << "" << std::setw(10) << "[sec]" << std::setw(10) << "[sec]" << std::setw(10) << "[sec]"
+		<< std::setw(10) << "" << std::setw(10) << "" << std::setw(12) << "" << std::setw(10) << "[sec]" << '\n';
+
+	for (const auto& r : results)
+	{
+		ss << std::setw(8) << r.policy.checkPeriod << std::setw(10) << r.policy.timing.followUpPeriodDivisor
+			<< std::setw(10) << r.policy.timing.postponePeriods
+			<< std::setw(10) << (std::to_string(r.detectedCount) + '/' + std::to_string(r.openingCount))
+			<< std::setprecision(1) << std::setw(10) << r.meanLatency << std::setw(10) << r.p95Latency << std::setw(10) << r.maxLatency
+			<< std::setw(10) << r.requestCount << std::setw(10) << (hours > 0.0 ? r.requestCount / hours : 0.0)
+			<< std::setprecision(2) << std::setw(12) << r.responseBytes / 1.0e6
+			<< std::setw(10) << r.runTime << '\n';
+	}
+
+	return ss.str();
+}
+
+bool Simulator::RunFromCommandLine(const std::string& timelineFileName, const LogFunction& log)
+{
+	Simulator simulator;
+	if (!simulator.Load(timelineFileName))
+	{
+		log("Failed to load simulation timeline '" + timelineFileName + "'");
+		return false;
+	}
+
+	const auto policies(simulator.GetPolicyGrid());
+	std::vector<Result> results;
+	for (const auto& policy : policies)
+	{
+		results.push_back(simulator.Run(policy));
+		log("Simulated policy " + std::to_string(results.size()) + " of " + std::to_string(policies.size()));
+	}
+
+	const std::string report(simulator.FormatReport(results));
+	log("Simulation report:\n" + report);
+
+	const std::string reportFileName(timelineFileName + ".report.txt");
+	std::ofstream reportFile(reportFileName);
+	if (!reportFile.is_open())
+	{
+		log("Failed to write '" + reportFileName + "'");
+		return false;
+	}
+
+	reportFile << report;
+	log("Simulation report written to '" + reportFileName + "'");
+	return true;
+}
+
+std::shared_ptr<const std::string> Simulator::FindResponse(const std::string& url, const std::chrono::seconds& time) const
+{
+	const auto exact(responses.find(url));
+	if (exact != responses.end())
+		return Latest(exact->second, time);
+
+	// Longest matching prefix wins
+	std::shared_ptr<const std::string> body;
+	size_t matchLength(0);
+	for (const auto& r : prefixResponses)
+	{
+		if (r.first.length() >= matchLength && url.compare(0, r.first.length(), r.first) == 0)
+		{
+			body = Latest(r.second, time);
+			matchLength = r.first.length();
+		}
+	}
+
+	return body;
+}
+
+std::shared_ptr<const std::string> Simulator::Latest(const std::vector<TimedResponse>& timeline, const std::chrono::seconds& time)
+{
+	const auto next(std::upper_bound(timeline.begin(), timeline.end(), time,
+		[](const std::chrono::seconds& t, const TimedResponse& r) { return t < r.time; }));
+	if (next == timeline.begin())
+		return nullptr;
+	return std::prev(next)->body;
+}
+
+std::vector<std::string> Simulator::Split(const std::string& s, const char& delimiter)
+{
+	std::vector<std::string> parts;
+	std::istringstream ss(s);
+	std::string part;
+	while (std::getline(ss, part, delimiter))
+	{
+		if (!part.empty())
+			parts.push_back(part);
+	}
+
+	return parts;
+}
+
+void Simulator::VirtualClock::WaitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+	const std::chrono::system_clock::time_point& wakeTime, const std::function<bool()>& isStopped)
+{
+	if (isStopped())
+		return;
+
+	if (wakeTime < end)
+	{
+		if (wakeTime > now.load())
+			now = wakeTime;
+		return;
+	}
+
+	now = end;
+	{
+		std::lock_guard<std::mutex> endLock(endMutex);
+		reachedEnd = true;
+	}
+	endCondition.notify_all();
+
+	// Nothing more to replay; sit here until the simulator stops the target
+	condition.wait(lock, isStopped);
+}
+
+void Simulator::VirtualClock::WaitForEnd()
+{
+	std::unique_lock<std::mutex> lock(endMutex);
+	endCondition.wait(lock, [this]() { return reachedEnd; });
+}
+
+Simulator::Replay::Replay(const Simulator& simulator, const std::chrono::system_clock::time_point& start)
+	: simulator(simulator), start(start), clock(start, start + simulator.duration)
+{
+}
+
+std::chrono::seconds Simulator::Replay::Elapsed() const
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(clock.Now() - start);
+}
+
+RequestCoalescer::Response Simulator::Replay::Respond(const std::string& url)
+{
+	++requestCount;
+
+	// Anything not in the timeline (e.g. base pages, which are only fetched for cookies) gets an empty page
+	RequestCoalescer::Response response;
+	response.result = CURLE_OK;
+	response.responseCode = 200;
+	const auto body(simulator.FindResponse(url, Elapsed()));
+	if (body)
+	{
+		response.body = *body;
+		responseBytes += body->size();
+	}
+
+	return response;
+}
+
+void Simulator::Replay::OnAppointmentsAvailable(const std::string&)
+{
+	hitTimes.push_back(Elapsed());
+}
@@ -0,0 +1,157 @@
+// File:  simulator.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Replays a recorded timeline of responses against a target on a virtual clock, so
+//        check timing policies can be compared (detection latency vs. request volume) in
+//        seconds instead of days and without touching the real sites.
+
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+// Local headers
+#include "finderTarget.h"
+#include "clock.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+
+class Simulator
+{
+public:
+	// Timeline format (one entry per line; '#' starts a comment, times are seconds from the start):
+	//   target <cvs|jefferson|riteaid> [args]     cvs:  [excludeLocation;...]   riteaid:  <phillyMode 0|1> <location;...>
+	//   response <time> <url> <bodyFile>          Served for url (a trailing '*' matches any url with that prefix) from time on
+	//   opening <time> <duration>                 Appointments were available for this window
+	//   end <time>
+	// Body files are relative to the timeline file.  Requests for anything else get an empty page.
+	bool Load(const std::string& timelineFileName);
+
+	struct Policy
+	{
+		unsigned int checkPeriod;// [sec]
+		FinderTarget::TimingPolicy timing;
+	};
+
+	struct Result
+	{
+		Policy policy;
+		unsigned int openingCount = 0;
+		unsigned int detectedCount = 0;
+		double meanLatency = 0.0;// [sec]
+		double p95Latency = 0.0;// [sec]
+		double maxLatency = 0.0;// [sec]
+		unsigned long long requestCount = 0;
+		unsigned long long responseBytes = 0;
+		double runTime = 0.0;// [sec] wall clock
+	};
+
+	Result Run(const Policy& policy) const;
+
+	// Grid around the defaults; postponement only matters for Rite Aid
+	std::vector<Policy> GetPolicyGrid() const;
+
+	std::string FormatReport(const std::vector<Result>& results) const;
+
+	// For the --simulate command line option; progress and the report go to log (which may be called from
+	// any thread), and the report is also written next to the timeline
+	typedef std::function<void(const std::string&)> LogFunction;
+	static bool RunFromCommandLine(const std::string& timelineFileName, const LogFunction& log);
+
+private:
+	enum class TargetType
+	{
+		CVS,
+		Jefferson,
+		RiteAid
+	};
+
+	TargetType targetType = TargetType::CVS;
+	std::vector<std::string> targetLocations;// Exclusions for CVS, search locations for Rite Aid
+	bool phillyMode = false;
+
+	struct TimedResponse
+	{
+		std::chrono::seconds time;
+		std::shared_ptr<const std::string> body;
+	};
+
+	// In time order for each url
+	std::map<std::string, std::vector<TimedResponse>> responses;
+	std::map<std::string, std::vector<TimedResponse>> prefixResponses;
+
+	struct Opening
+	{
+		std::chrono::seconds start;
+		std::chrono::seconds duration;
+	};
+
+	std::vector<Opening> openings;
+	std::chrono::seconds duration = std::chrono::seconds(0);
+
+	static const std::chrono::seconds defaultDuration;// When the timeline has no end entry
+
+	// Time passes only when the target waits, and then it jumps straight to the wake time
+	class VirtualClock : public Clock
+	{
+	public:
+		VirtualClock(const std::chrono::system_clock::time_point& start, const std::chrono::system_clock::time_point& end)
+			: now(start), end(end) {}
+
+		std::chrono::system_clock::time_point Now() const override { return now; }
+		void WaitUntil(std::unique_lock<std::mutex>& lock, std::condition_variable& condition,
+			const std::chrono::system_clock::time_point& wakeTime, const std::function<bool()>& isStopped) override;
+
+		// Blocks until the target has waited past the end of the timeline
+		void WaitForEnd();
+
+	private:
+		std::atomic<std::chrono::system_clock::time_point> now;
+		const std::chrono::system_clock::time_point end;
+
+		std::mutex endMutex;
+		std::condition_variable endCondition;
+		bool reachedEnd = false;
+	};
+
+	class Replay : public FinderTarget::Simulation
+	{
+	public:
+		Replay(const Simulator& simulator, const std::chrono::system_clock::time_point& start);
+
+		Clock& GetClock() override { return clock; }
+		RequestCoalescer::Response Respond(const std::string& url) override;
+		void OnAppointmentsAvailable(const std::string& appointmentInfo) override;
+
+		VirtualClock& GetVirtualClock() { return clock; }
+
+		// Read these after the target has been joined
+		std::vector<std::chrono::seconds> hitTimes;
+		unsigned long long requestCount = 0;
+		unsigned long long responseBytes = 0;
+
+	private:
+		const Simulator& simulator;
+		const std::chrono::system_clock::time_point start;
+		VirtualClock clock;
+
+		std::chrono::seconds Elapsed() const;
+	};
+
+	std::shared_ptr<const std::string> FindResponse(const std::string& url, const std::chrono::seconds& time) const;
+	static std::shared_ptr<const std::string> Latest(const std::vector<TimedResponse>& timeline, const std::chrono::seconds& time);
+
+	std::unique_ptr<FinderTarget> CreateTarget(const unsigned int& checkPeriod) const;
+	void Evaluate(const std::vector<std::chrono::seconds>& hitTimes, Result& result) const;
+
+	static std::vector<std::string> Split(const std::string& s, const char& delimiter);
+};
+
+#endif// SIMULATOR_H_
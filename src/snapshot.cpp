@@ -0,0 +1,188 @@
+// File:  snapshot.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Binary serialization of runtime state, so a restarted instance can pick up where the
+//        last one left off.  Values are written in native byte order - snapshots are meant to be
+//        read back by the same build on the same machine, not exchanged.
+
+// Local headers
+#include "snapshot.h"
+
+// Standard C++ headers
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstring>
+
+const std::string SnapshotFile::magic("VFSNAP");
+const unsigned int SnapshotFile::version(1);
+
+template<typename T>
+void SnapshotWriter::WriteRaw(const T& value)
+{
+	data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void SnapshotWriter::Write(const bool& value)
+{
+	WriteRaw(static_cast<unsigned char>(value ? 1 : 0));
+}
+
+void SnapshotWriter::Write(const unsigned int& value)
+{
+	WriteRaw(value);
+}
+
+void SnapshotWriter::Write(const unsigned long long& value)
+{
+	WriteRaw(value);
+}
+
+void SnapshotWriter::Write(const double& value)
+{
+	WriteRaw(value);
+}
+
+void SnapshotWriter::Write(const std::string& value)
+{
+	Write(static_cast<unsigned long long>(value.size()));
+	data.append(value);
+}
+
+void SnapshotWriter::Write(const std::chrono::system_clock::time_point& value)
+{
+	WriteRaw(static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(value.time_since_epoch()).count()));
+}
+
+template<typename T>
+bool SnapshotReader::ReadRaw(T& value)
+{
+	if (data.size() - position < sizeof(T))
+	{
+		position = data.size();
+		return false;
+	}
+
+	std::memcpy(&value, data.data() + position, sizeof(T));
+	position += sizeof(T);
+	return true;
+}
+
+bool SnapshotReader::Read(bool& value)
+{
+	unsigned char c;
+	if (!ReadRaw(c))
+		return false;
+
+	value = c != 0;
+	return true;
+}
+
+bool SnapshotReader::Read(unsigned int& value)
+{
+	return ReadRaw(value);
+}
+
+bool SnapshotReader::Read(unsigned long long& value)
+{
+	return ReadRaw(value);
+}
+
+bool SnapshotReader::Read(double& value)
+{
+	return ReadRaw(value);
+}
+
+bool SnapshotReader::Read(std::string& value)
+{
+	unsigned long long size;
+	if (!Read(size))
+		return false;
+
+	if (data.size() - position < size)
+	{
+		position = data.size();
+		return false;
+	}
+
+	value.assign(data.data() + position, static_cast<size_t>(size));
+	position += static_cast<size_t>(size);
+	return true;
+}
+
+bool SnapshotReader::Read(std::chrono::system_clock::time_point& value)
+{
+	long long milliseconds;
+	if (!ReadRaw(milliseconds))
+		return false;
+
+	value = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(milliseconds)));
+	return true;
+}
+
+// Written to a temporary file first, so a crash part way through leaves the previous snapshot intact
+bool SnapshotFile::Write(const std::string& fileName, const std::map<std::string, std::string>& sections)
+{
+	SnapshotWriter writer;
+	writer.Write(static_cast<unsigned int>(sections.size()));
+	for (const auto& section : sections)
+	{
+		writer.Write(section.first);
+		writer.Write(section.second);
+	}
+
+	const std::string tempFileName(fileName + ".tmp");
+	{
+		std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(magic.data(), magic.size());
+		file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+		file.write(writer.GetData().data(), writer.GetData().size());
+		if (!file.good())
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempFileName, fileName, error);
+	return !error;
+}
+
+bool SnapshotFile::Read(const std::string& fileName, std::map<std::string, std::string>& sections)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	const std::string data(contents.str());
+	if (data.size() < magic.size() + sizeof(version) || data.compare(0, magic.size(), magic) != 0)
+		return false;
+
+	unsigned int fileVersion;
+	std::memcpy(&fileVersion, data.data() + magic.size(), sizeof(fileVersion));
+	if (fileVersion != version)
+		return false;
+
+	SnapshotReader reader(std::string_view(data).substr(magic.size() + sizeof(version)));
+	unsigned int count;
+	if (!reader.Read(count))
+		return false;
+
+	sections.clear();
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		std::string name, section;
+		if (!reader.Read(name) || !reader.Read(section))
+		{
+			sections.clear();
+			return false;
+		}
+
+		sections[name] = std::move(section);
+	}
+
+	return true;
+}
@@ -0,0 +1,69 @@
+// File:  snapshot.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Binary serialization of runtime state, so a restarted instance can pick up where the
+//        last one left off.  Values are written in native byte order - snapshots are meant to be
+//        read back by the same build on the same machine, not exchanged.
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+// Standard C++ headers
+#include <string>
+#include <string_view>
+#include <map>
+#include <chrono>
+
+class SnapshotWriter
+{
+public:
+	void Write(const bool& value);
+	void Write(const unsigned int& value);
+	void Write(const unsigned long long& value);
+	void Write(const double& value);
+	void Write(const std::string& value);
+	void Write(const std::chrono::system_clock::time_point& value);
+
+	const std::string& GetData() const { return data; }
+
+private:
+	std::string data;
+
+	template<typename T>
+	void WriteRaw(const T& value);
+};
+
+// Every Read() fails once the data runs out, so a sequence of reads only needs to be checked as a whole
+class SnapshotReader
+{
+public:
+	explicit SnapshotReader(std::string_view data) : data(data) {}
+
+	bool Read(bool& value);
+	bool Read(unsigned int& value);
+	bool Read(unsigned long long& value);
+	bool Read(double& value);
+	bool Read(std::string& value);
+	bool Read(std::chrono::system_clock::time_point& value);
+
+private:
+	std::string_view data;
+	size_t position = 0;
+
+	template<typename T>
+	bool ReadRaw(T& value);
+};
+
+// File of named sections (one per target, etc.); the whole file is ignored if its version doesn't match
+class SnapshotFile
+{
+public:
+	static bool Write(const std::string& fileName, const std::map<std::string, std::string>& sections);
+	static bool Read(const std::string& fileName, std::map<std::string, std::string>& sections);
+
+private:
+	static const std::string magic;
+	static const unsigned int version;// Increment when the layout of any section changes
+};
+
+#endif// SNAPSHOT_H_
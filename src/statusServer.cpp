@@ -0,0 +1,259 @@
+// File:  statusServer.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Small embedded HTTP server for watching the finder from outside the UI.  GET /status
+//        returns every target's latest state as JSON; GET /events is a server-sent event stream
+//        of hits and transitions.  Targets publish complete, immutable status documents that are
+//        swapped in atomically, so serving a request never waits on a check.
+
+// Local headers
+#include "statusServer.h"
+#include "utilities/uString.h"
+
+// wxWidgets headers
+#include <wx/socket.h>
+
+// Standard C++ headers
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+const unsigned short StatusServer::defaultPort(8086);
+const size_t StatusServer::maxRecentEvents(100);
+const std::chrono::steady_clock::duration StatusServer::keepAliveInterval(std::chrono::seconds(15));
+const long StatusServer::pollInterval(250);
+const long StatusServer::requestTimeout(2);
+const size_t StatusServer::maxRequestSize(8192);
+
+StatusServer::StatusServer(const unsigned short& port) : port(port), status(std::make_shared<const StatusMap>())
+{
+	// Sockets can only be used from other threads (in blocking mode) once they've been initialized on the main thread
+	if (!wxSocketBase::IsInitialized() && !wxSocketBase::Initialize())
+	{
+		Cerr << "Failed to initialize sockets; status server is disabled\n";
+		return;
+	}
+
+	serverThread = std::thread(&StatusServer::ThreadEntry, this);
+}
+
+StatusServer::~StatusServer()
+{
+	stop = true;
+	if (serverThread.joinable())
+		serverThread.join();
+}
+
+void StatusServer::PublishStatus(const std::string& source, std::string&& json)
+{
+	auto current(status.load());
+	std::shared_ptr<const StatusMap> updated;
+	do
+	{
+		auto copy(std::make_shared<StatusMap>(*current));
+		(*copy)[source] = json;
+		updated = std::move(copy);
+	} while (!status.compare_exchange_weak(current, updated));
+}
+
+void StatusServer::ClearStatus()
+{
+	status.store(std::make_shared<const StatusMap>());
+}
+
+void StatusServer::PostEvent(const std::string& type, std::string&& json)
+{
+	Event event;
+	event.type = type;
+	event.data = std::move(json);
+	newEvents.Push(std::move(event));
+}
+
+void StatusServer::ThreadEntry()
+{
+	wxIPV4address address;
+	address.Hostname(_T("127.0.0.1"));
+	address.Service(port);
+
+	wxSocketServer server(address, wxSOCKET_BLOCK | wxSOCKET_REUSEADDR);
+	if (!server.IsOk())
+	{
+		Cerr << "Failed to start status server on port " << port << '\n';
+		return;
+	}
+
+	lastKeepAlive = std::chrono::steady_clock::now();
+	while (!stop)
+	{
+		if (server.WaitForAccept(0, pollInterval))
+		{
+			std::unique_ptr<wxSocketBase> client(server.Accept(false));
+			if (client)
+				HandleConnection(std::move(client));
+		}
+
+		DistributeEvents();
+	}
+
+	eventStreams.clear();
+}
+
+void StatusServer::HandleConnection(std::unique_ptr<wxSocketBase> client)
+{
+	client->SetFlags(wxSOCKET_BLOCK);
+	client->SetTimeout(requestTimeout);
+
+	std::string method, path;
+	unsigned long long lastEventId(0);
+	if (!ReadRequest(*client, method, path, lastEventId))
+	{
+		Send(*client, FormatResponse("400 Bad Request", "text/plain", "Bad request\n"));
+		return;
+	}
+
+	if (method != "GET")
+		Send(*client, FormatResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+	else if (path == "/status")
+		Send(*client, FormatResponse("200 OK", "application/json", GetStatusDocument()));
+	else if (path == "/events")
+		BeginEventStream(std::move(client), lastEventId);
+	else
+		Send(*client, FormatResponse("404 Not Found", "text/plain", "Try /status or /events\n"));
+}
+
+// Reads the request line and headers; the only header we care about is Last-Event-ID
+bool StatusServer::ReadRequest(wxSocketBase& client, std::string& method, std::string& path, unsigned long long& lastEventId)
+{
+	std::string request;
+	char buffer[1024];
+	while (request.find("\r\n\r\n") == std::string::npos)
+	{
+		if (request.size() > maxRequestSize)
+			return false;
+
+		client.Read(buffer, sizeof(buffer));
+		if (client.Error() || client.LastCount() == 0)
+			return false;
+		request.append(buffer, client.LastCount());
+	}
+
+	std::istringstream ss(request);
+	std::string line, version;
+	if (!std::getline(ss, line))
+		return false;
+
+	std::istringstream requestLine(line);
+	if (!(requestLine >> method >> path >> version) || version.compare(0, 5, "HTTP/") != 0)
+		return false;
+	path = path.substr(0, path.find('?'));
+
+	while (std::getline(ss, line) && line != "\r")
+	{
+		const auto colon(line.find(':'));
+		if (colon == std::string::npos)
+			continue;
+
+		std::string name(line.substr(0, colon));
+		std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char& c) { return static_cast<char>(std::tolower(c)); });
+		if (name == "last-event-id")
+			lastEventId = std::strtoull(line.c_str() + colon + 1, nullptr, 10);
+	}
+
+	return true;
+}
+
+std::string StatusServer::GetStatusDocument() const
+{
+	const auto current(status.load());
+
+	std::ostringstream ss;
+	ss << "{\"generated\":" << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+		<< ",\"targets\":[";
+	for (auto it = current->begin(); it != current->end(); ++it)
+	{
+		if (it != current->begin())
+			ss << ',';
+		ss << it->second;
+	}
+	ss << "]}\n";
+	return ss.str();
+}
+
+void StatusServer::BeginEventStream(std::unique_ptr<wxSocketBase> client, const unsigned long long& lastEventId)
+{
+	std::ostringstream ss;
+	ss << "HTTP/1.1 200 OK\r\n"
+		<< "Content-Type: text/event-stream\r\n"
+		<< "Cache-Control: no-cache\r\n"
+		<< "Connection: keep-alive\r\n"
+		<< "\r\n"
+		<< "retry: 5000\n\n";
+
+	// Replay whatever a reconnecting client missed (as far back as we remember)
+	if (lastEventId > 0)
+	{
+		for (const auto& event : recentEvents)
+		{
+			if (event.id > lastEventId)
+				ss << FormatEvent(event);
+		}
+	}
+
+	if (Send(*client, ss.str()))
+		eventStreams.push_back(std::move(client));
+}
+
+void StatusServer::DistributeEvents()
+{
+	Event event;
+	while (newEvents.Pop(event))
+	{
+		event.id = nextEventId++;
+		SendToEventStreams(FormatEvent(event));
+
+		recentEvents.push_back(std::move(event));
+		if (recentEvents.size() > maxRecentEvents)
+			recentEvents.pop_front();
+	}
+
+	// Comments keep proxies from timing out idle streams, and let us notice clients that have gone away
+	const auto now(std::chrono::steady_clock::now());
+	if (now - lastKeepAlive > keepAliveInterval)
+	{
+		SendToEventStreams(": keep-alive\n\n");
+		lastKeepAlive = now;
+	}
+}
+
+void StatusServer::SendToEventStreams(const std::string& data)
+{
+	eventStreams.erase(std::remove_if(eventStreams.begin(), eventStreams.end(),
+		[&data](const std::unique_ptr<wxSocketBase>& client) { return !Send(*client, data); }), eventStreams.end());
+}
+
+std::string StatusServer::FormatResponse(const std::string& status, const std::string& contentType, const std::string& body)
+{
+	std::ostringstream ss;
+	ss << "HTTP/1.1 " << status << "\r\n"
+		<< "Content-Type: " << contentType << "\r\n"
+		<< "Content-Length: " << body.size() << "\r\n"
+		<< "Cache-Control: no-cache\r\n"
+		<< "Connection: close\r\n"
+		<< "\r\n"
+		<< body;
+	return ss.str();
+}
+
+// Event data is a single line of JSON, so it never needs splitting into multiple data fields
+std::string StatusServer::FormatEvent(const Event& event)
+{
+	return "id: " + std::to_string(event.id) + "\nevent: " + event.type + "\ndata: " + event.data + "\n\n";
+}
+
+bool StatusServer::Send(wxSocketBase& client, const std::string& data)
+{
+	client.SetFlags(wxSOCKET_BLOCK | wxSOCKET_WAITALL);
+	client.Write(data.data(), static_cast<unsigned int>(data.size()));
+	return !client.Error() && client.LastCount() == data.size();
+}
@@ -0,0 +1,89 @@
+// File:  statusServer.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Small embedded HTTP server for watching the finder from outside the UI.  GET /status
+//        returns every target's latest state as JSON; GET /events is a server-sent event stream
+//        of hits and transitions.  Targets publish complete, immutable status documents that are
+//        swapped in atomically, so serving a request never waits on a check.
+
+#ifndef STATUS_SERVER_H_
+#define STATUS_SERVER_H_
+
+// Local headers
+#include "mpscQueue.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+// wxWidgets forward declarations
+class wxSocketBase;
+
+class StatusServer
+{
+public:
+	// Listens on the loopback interface only; construct on the main thread (wx sockets are initialized there)
+	explicit StatusServer(const unsigned short& port);
+	~StatusServer();
+
+	static const unsigned short defaultPort;
+
+	// Thread-safe; json is a complete JSON object that replaces the source's previous status
+	void PublishStatus(const std::string& source, std::string&& json);
+	void ClearStatus();
+
+	// Thread-safe and doesn't block; json (a JSON object) becomes the event's data
+	void PostEvent(const std::string& type, std::string&& json);
+
+private:
+	const unsigned short port;
+
+	// Copy-on-write:  publishers build a new map and swap it in, readers just take a reference to the current one
+	typedef std::map<std::string, std::string> StatusMap;
+	std::atomic<std::shared_ptr<const StatusMap>> status;
+
+	struct Event
+	{
+		unsigned long long id = 0;
+		std::string type;
+		std::string data;
+	};
+
+	MPSCQueue<Event> newEvents;
+
+	// The rest is only used on the server thread
+	static const size_t maxRecentEvents;// Kept so reconnecting clients (Last-Event-ID) don't miss anything
+	std::deque<Event> recentEvents;
+	unsigned long long nextEventId = 1;
+
+	static const std::chrono::steady_clock::duration keepAliveInterval;
+	std::chrono::steady_clock::time_point lastKeepAlive;
+	std::vector<std::unique_ptr<wxSocketBase>> eventStreams;
+
+	static const long pollInterval;// [msec]
+	static const long requestTimeout;// [sec]
+	static const size_t maxRequestSize;// [bytes]
+
+	std::atomic<bool> stop = false;
+	std::thread serverThread;
+	void ThreadEntry();
+
+	void HandleConnection(std::unique_ptr<wxSocketBase> client);
+	static bool ReadRequest(wxSocketBase& client, std::string& method, std::string& path, unsigned long long& lastEventId);
+	std::string GetStatusDocument() const;
+	void BeginEventStream(std::unique_ptr<wxSocketBase> client, const unsigned long long& lastEventId);
+	void DistributeEvents();
+	void SendToEventStreams(const std::string& data);
+
+	static std::string FormatResponse(const std::string& status, const std::string& contentType, const std::string& body);
+	static std::string FormatEvent(const Event& event);
+	static bool Send(wxSocketBase& client, const std::string& data);
+};
+
+#endif// STATUS_SERVER_H_
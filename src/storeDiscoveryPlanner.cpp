@@ -0,0 +1,355 @@
+// File:  storeDiscoveryPlanner.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Chooses which store-finder queries to send when refreshing the store list.  Store
+//        finders only return the nearest few stores, so overlapping queries mostly repeat each
+//        other while a crowded area can still hide stores past the last one returned.  This
+//        keeps a grid index of known stores, sends the smallest set of queries that reaches all
+//        of them, and adds queries only where a result was cut off.
+
+// Local headers
+#include "storeDiscoveryPlanner.h"
+#include "geo.h"
+
+// Standard C++ headers
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+const unsigned int StoreDiscoveryPlanner::fullSweepInterval(7);
+const unsigned int StoreDiscoveryPlanner::maxFollowUpsPerArea(4);
+const double StoreDiscoveryPlanner::cellSize(0.1);
+
+StoreDiscoveryPlanner::StoreDiscoveryPlanner(const std::vector<std::string>& areas, const double& searchRadius,
+	const unsigned int& resultLimit) : searchRadius(searchRadius), resultLimit(resultLimit)
+{
+	for (unsigned int i = 0; i < areas.size(); ++i)
+	{
+		QueryPoint p;
+		p.address = areas[i];
+		p.area = i;
+		queryPoints.push_back(p);
+	}
+}
+
+std::vector<std::string> StoreDiscoveryPlanner::Plan()
+{
+	++updateCount;
+	followUps.clear();
+
+	// Anything that has never run has to; on a full sweep, so does everything else
+	fullSweep = updateCount % fullSweepInterval == 1;
+	std::vector<bool> selected(queryPoints.size(), false);
+	std::set<unsigned int> knownStores;
+	std::set<unsigned int> coveredStores;
+	for (size_t i = 0; i < queryPoints.size(); ++i)
+	{
+		const auto& p(queryPoints[i]);
+		knownStores.insert(p.lastResults.begin(), p.lastResults.end());
+		if (fullSweep || !p.hasRun)
+		{
+			selected[i] = true;
+			coveredStores.insert(p.lastResults.begin(), p.lastResults.end());
+		}
+	}
+
+	// Greedy set cover - repeatedly take the query that reaches the most stores not yet covered
+	while (coveredStores.size() < knownStores.size())
+	{
+		size_t best(queryPoints.size());
+		size_t bestGain(0);
+		for (size_t i = 0; i < queryPoints.size(); ++i)
+		{
+			if (selected[i])
+				continue;
+
+			const size_t gain(std::count_if(queryPoints[i].lastResults.begin(), queryPoints[i].lastResults.end(),
+				[&coveredStores](const unsigned int& s) { return coveredStores.find(s) == coveredStores.end(); }));
+			if (gain > bestGain)
+			{
+				best = i;
+				bestGain = gain;
+			}
+		}
+
+		if (bestGain == 0)
+			break;
+
+		selected[best] = true;
+		coveredStores.insert(queryPoints[best].lastResults.begin(), queryPoints[best].lastResults.end());
+	}
+
+	std::vector<std::string> addresses;
+	for (size_t i = 0; i < queryPoints.size(); ++i)
+	{
+		if (selected[i])
+			addresses.push_back(queryPoints[i].address);
+	}
+
+	lastPlanSize = static_cast<unsigned int>(addresses.size());
+	return addresses;
+}
+
+std::vector<std::string> StoreDiscoveryPlanner::PlanFollowUps()
+{
+	std::vector<std::string> addresses;
+	for (const auto& i : followUps)
+		addresses.push_back(queryPoints[i].address);
+
+	followUps.clear();
+	lastPlanSize += static_cast<unsigned int>(addresses.size());
+	return addresses;
+}
+
+void StoreDiscoveryPlanner::Record(const std::string& address, const std::vector<Store>& results)
+{
+	const auto point(std::find_if(queryPoints.begin(), queryPoints.end(), [&address](const QueryPoint& p) { return p.address == address; }));
+	if (point == queryPoints.end())
+		return;
+
+	point->hasRun = true;
+	point->lastResults.clear();
+	const Store* nearest(nullptr);
+	const Store* farthest(nullptr);
+	for (const auto& s : results)
+	{
+		point->lastResults.push_back(s.number);
+		if (!s.hasPosition)
+			continue;
+
+		if (storePositions.emplace(s.number, Position{ s.latitude, s.longitude }).second)
+			grid[GetCellKey(Position{ s.latitude, s.longitude })].push_back(s.number);
+
+		if (!nearest || s.distance < nearest->distance)
+			nearest = &s;
+		if (!farthest || s.distance > farthest->distance)
+			farthest = &s;
+	}
+
+	if (!nearest)
+		return;
+
+	// A short list means the finder ran out of stores before it ran out of radius, so nothing nearby is hidden
+	const bool cutOff(results.size() >= resultLimit);
+	point->hasCoverage = true;
+	point->centerLatitude = nearest->latitude;
+	point->centerLongitude = nearest->longitude;
+	point->coverageRadius = cutOff ? farthest->distance : searchRadius;
+	if (!cutOff)
+		return;
+
+	// There may be more stores past the edge of what came back; look from the far side, then from opposite that
+	const Position farPosition{ farthest->latitude, farthest->longitude };
+	const Store* opposite(nullptr);
+	double oppositeDistance(0.0);
+	for (const auto& s : results)
+	{
+		if (!s.hasPosition)
+			continue;
+
+		const double d(GetDistance(farPosition, Position{ s.latitude, s.longitude }));
+		if (d > oppositeDistance)
+		{
+			opposite = &s;
+			oppositeDistance = d;
+		}
+	}
+
+	const unsigned int area(point->area);// ProposeFollowUp() may invalidate point
+	ProposeFollowUp(*farthest, area);
+	if (opposite)
+		ProposeFollowUp(*opposite, area);
+}
+
+void StoreDiscoveryPlanner::ProposeFollowUp(const Store& store, const unsigned int& area)
+{
+	if (store.zip.empty())
+		return;
+
+	unsigned int areaFollowUps(0);
+	for (const auto& p : queryPoints)
+	{
+		if (p.address == store.zip)
+			return;
+		if (p.area == area)
+			++areaFollowUps;
+	}
+
+	if (areaFollowUps > maxFollowUpsPerArea)// Count includes the area's own query
+		return;
+
+	const Position position{ store.latitude, store.longitude };
+	if (!IsInArea(position, area))
+		return;
+
+	// A query here reaches out to its resultLimit-th nearest store; if that disk has already been seen in full, it can't find anything new
+	const auto nearest(GetNearestDistances(position));
+	if (nearest.size() >= resultLimit && IsCovered(position, nearest.back()))
+		return;
+
+	QueryPoint p;
+	p.address = store.zip;
+	p.area = area;
+	followUps.push_back(queryPoints.size());
+	queryPoints.push_back(p);
+}
+
+void StoreDiscoveryPlanner::Save(SnapshotWriter& writer) const
+{
+	writer.Write(updateCount);
+	writer.Write(static_cast<unsigned int>(queryPoints.size()));
+	for (const auto& p : queryPoints)
+	{
+		writer.Write(p.address);
+		writer.Write(p.area);
+		writer.Write(p.hasRun);
+		writer.Write(static_cast<unsigned int>(p.lastResults.size()));
+		for (const auto& r : p.lastResults)
+			writer.Write(r);
+		writer.Write(p.hasCoverage);
+		writer.Write(p.centerLatitude);
+		writer.Write(p.centerLongitude);
+		writer.Write(p.coverageRadius);
+	}
+
+	writer.Write(static_cast<unsigned int>(storePositions.size()));
+	for (const auto& s : storePositions)
+	{
+		writer.Write(s.first);
+		writer.Write(s.second.latitude);
+		writer.Write(s.second.longitude);
+	}
+}
+
+bool StoreDiscoveryPlanner::Load(SnapshotReader& reader)
+{
+	unsigned int savedUpdateCount, count;
+	if (!reader.Read(savedUpdateCount) || !reader.Read(count))
+		return false;
+
+	std::vector<QueryPoint> savedPoints(count);
+	for (auto& p : savedPoints)
+	{
+		unsigned int resultCount;
+		if (!reader.Read(p.address) || !reader.Read(p.area) || !reader.Read(p.hasRun) || !reader.Read(resultCount))
+			return false;
+
+		p.lastResults.resize(resultCount);
+		for (auto& r : p.lastResults)
+		{
+			if (!reader.Read(r))
+				return false;
+		}
+
+		if (!reader.Read(p.hasCoverage) || !reader.Read(p.centerLatitude) ||
+			!reader.Read(p.centerLongitude) || !reader.Read(p.coverageRadius))
+			return false;
+	}
+
+	std::map<unsigned int, Position> savedPositions;
+	if (!reader.Read(count))
+		return false;
+
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		unsigned int number;
+		Position position;
+		if (!reader.Read(number) || !reader.Read(position.latitude) || !reader.Read(position.longitude))
+			return false;
+		savedPositions[number] = position;
+	}
+
+	for (unsigned int i = 0; i < queryPoints.size(); ++i)
+	{
+		if (i >= savedPoints.size() || savedPoints[i].address != queryPoints[i].address)
+			return true;// Different areas; start over
+	}
+
+	updateCount = savedUpdateCount;
+	queryPoints.swap(savedPoints);
+	storePositions.swap(savedPositions);
+	grid.clear();
+	for (const auto& s : storePositions)
+		grid[GetCellKey(s.second)].push_back(s.first);
+
+	return true;
+}
+
+std::vector<double> StoreDiscoveryPlanner::GetNearestDistances(const Position& p) const
+{
+	const double cellMiles(cellSize * Geo::GetMilesPerDegreeLongitude(p.latitude));// Narrowest side of a cell here
+	const int maxRing(static_cast<int>(std::ceil(searchRadius / cellMiles)) + 1);
+	const int row(Geo::GetCellIndex(p.latitude, cellSize));
+	const int column(Geo::GetCellIndex(p.longitude, cellSize));
+
+	std::vector<double> distances;
+	for (int ring = 0; ring <= maxRing; ++ring)
+	{
+		for (int r = row - ring; r <= row + ring; ++r)
+		{
+			for (int c = column - ring; c <= column + ring; ++c)
+			{
+				if (std::abs(r - row) != ring && std::abs(c - column) != ring)
+					continue;// Inner cells were done in earlier rings
+
+				const auto cell(grid.find(Geo::GetCellKey(r, c)));
+				if (cell == grid.end())
+					continue;
+
+				for (const auto& s : cell->second)
+				{
+					const double d(GetDistance(p, storePositions.at(s)));
+					if (d <= searchRadius)
+						distances.push_back(d);
+				}
+			}
+		}
+
+		// Anything in further rings is at least this far away
+		std::sort(distances.begin(), distances.end());
+		if (distances.size() >= resultLimit && distances[resultLimit - 1] <= ring * cellMiles)
+			break;
+	}
+
+	if (distances.size() > resultLimit)
+		distances.resize(resultLimit);
+	return distances;
+}
+
+bool StoreDiscoveryPlanner::IsCovered(const Position& p, const double& radius) const
+{
+	for (const auto& q : queryPoints)
+	{
+		if (q.hasCoverage && GetDistance(Position{ q.centerLatitude, q.centerLongitude }, p) + radius <= q.coverageRadius)
+			return true;
+	}
+
+	return false;
+}
+
+bool StoreDiscoveryPlanner::IsInArea(const Position& p, const unsigned int& area) const
+{
+	const auto& areaPoint(queryPoints[area]);
+	if (!areaPoint.hasCoverage)
+		return true;
+
+	return GetDistance(Position{ areaPoint.centerLatitude, areaPoint.centerLongitude }, p) <= searchRadius;
+}
+
+long long StoreDiscoveryPlanner::GetCellKey(const Position& p) const
+{
+	return Geo::GetCellKey(Geo::GetCellIndex(p.latitude, cellSize), Geo::GetCellIndex(p.longitude, cellSize));
+}
+
+double StoreDiscoveryPlanner::GetDistance(const Position& a, const Position& b)
+{
+	return Geo::GetDistance(a.latitude, a.longitude, b.latitude, b.longitude);
+}
+
+std::string StoreDiscoveryPlanner::GetSummary() const
+{
+	std::ostringstream ss;
+	ss << "Store discovery:  " << lastPlanSize << " queries (of " << queryPoints.size() << " query points), "
+		<< storePositions.size() << " stores located";
+	return ss.str();
+}
@@ -0,0 +1,106 @@
+// File:  storeDiscoveryPlanner.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Chooses which store-finder queries to send when refreshing the store list.  Store
+//        finders only return the nearest few stores, so overlapping queries mostly repeat each
+//        other while a crowded area can still hide stores past the last one returned.  This
+//        keeps a grid index of known stores, sends the smallest set of queries that reaches all
+//        of them, and adds queries only where a result was cut off.
+
+#ifndef STORE_DISCOVERY_PLANNER_H_
+#define STORE_DISCOVERY_PLANNER_H_
+
+// Local headers
+#include "snapshot.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+class StoreDiscoveryPlanner
+{
+public:
+	// searchRadius [miles] and resultLimit describe the store finder being queried
+	StoreDiscoveryPlanner(const std::vector<std::string>& areas, const double& searchRadius, const unsigned int& resultLimit);
+
+	struct Store
+	{
+		unsigned int number;
+		std::string zip;
+
+		bool hasPosition = false;// Older responses may not include coordinates; planning then falls back to store numbers only
+		double latitude = 0.0;// [deg]
+		double longitude = 0.0;// [deg]
+		double distance = 0.0;// From the query point [miles]
+	};
+
+	// Addresses to query for the next refresh
+	std::vector<std::string> Plan();
+
+	// Queries added because of results recorded since the last call (empty when coverage is complete)
+	std::vector<std::string> PlanFollowUps();
+
+	// Call with every store a query returned, whether or not it will be checked
+	void Record(const std::string& address, const std::vector<Store>& results);
+
+	// True if the last plan ran every query, so stores it didn't return can be dropped
+	bool WasFullSweep() const { return fullSweep; }
+
+	std::string GetSummary() const;
+
+	// Load only if constructed with the same areas as the saved planner
+	void Save(SnapshotWriter& writer) const;
+	bool Load(SnapshotReader& reader);
+
+private:
+	const double searchRadius;
+	const unsigned int resultLimit;
+
+	static const unsigned int fullSweepInterval;// Every so often, run every query to pick up new stores
+	static const unsigned int maxFollowUpsPerArea;
+	static const double cellSize;// [deg]
+
+	struct QueryPoint
+	{
+		std::string address;
+		unsigned int area;// Index of the user area this query serves
+		bool hasRun = false;
+		std::vector<unsigned int> lastResults;
+
+		// Everything within coverageRadius of the center has been seen (center is estimated from the nearest result)
+		bool hasCoverage = false;
+		double centerLatitude = 0.0;
+		double centerLongitude = 0.0;
+		double coverageRadius = 0.0;
+	};
+
+	std::vector<QueryPoint> queryPoints;// User areas first, in order
+	std::vector<size_t> followUps;// Added since the last plan
+	unsigned int updateCount = 0;
+	bool fullSweep = false;
+	unsigned int lastPlanSize = 0;
+
+	struct Position
+	{
+		double latitude;
+		double longitude;
+	};
+
+	std::map<unsigned int, Position> storePositions;
+	std::unordered_map<long long, std::vector<unsigned int>> grid;
+	long long GetCellKey(const Position& p) const;
+
+	// Distances [miles] to the nearest known stores, up to resultLimit of them within searchRadius
+	std::vector<double> GetNearestDistances(const Position& p) const;
+
+	bool IsCovered(const Position& p, const double& radius) const;
+	bool IsInArea(const Position& p, const unsigned int& area) const;
+	void ProposeFollowUp(const Store& store, const unsigned int& area);
+
+	static double GetDistance(const Position& a, const Position& b);// [miles]
+};
+
+#endif// STORE_DISCOVERY_PLANNER_H_
@@ -0,0 +1,345 @@
+// File:  subscriptionEngine.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Matches availability changes to subscribers, so one set of targets can serve any number
+//        of people with their own areas, cities, stores and exclusions.  Subscribers are indexed
+//        by location, by city and by the grid cells their areas cover; a change only looks at the
+//        subscribers filed under its own location, city and cell.  Polling doesn't depend on
+//        subscribers at all - every location is still checked once per period.
+
+// Local headers
+#include "subscriptionEngine.h"
+#include "geo.h"
+#include "utilities/uString.h"
+#include "email/cJSON/cJSON.h"
+
+// Standard C++ headers
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+const double SubscriptionEngine::cellSize(0.25);
+
+bool SubscriptionEngine::Load(const std::string& fileName)
+{
+	std::ifstream file(fileName);
+	if (!file.is_open())
+		return true;
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+
+	cJSON* root(cJSON_Parse(contents.str().c_str()));
+	if (!root || !cJSON_IsArray(root))
+	{
+		Cerr << "Failed to parse subscriptions in '" << UString::ToStringType(fileName) << "'\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	const auto readStrings([](cJSON* object, const char* field, std::vector<std::string>& values)
+	{
+		cJSON* array(cJSON_GetObjectItem(object, field));
+		for (int i = 0; i < cJSON_GetArraySize(array); ++i)
+		{
+			cJSON* item(cJSON_GetArrayItem(array, i));
+			if (cJSON_IsString(item))
+				values.push_back(item->valuestring);
+		}
+	});
+
+	unsigned int skipped(0);
+	for (int i = 0; i < cJSON_GetArraySize(root); ++i)
+	{
+		cJSON* item(cJSON_GetArrayItem(root, i));
+		cJSON* id(cJSON_GetObjectItem(item, "id"));
+		if (!cJSON_IsString(id))
+		{
+			++skipped;
+			continue;
+		}
+
+		Subscriber subscriber;
+		subscriber.id = id->valuestring;
+
+		cJSON* areas(cJSON_GetObjectItem(item, "areas"));
+		for (int j = 0; j < cJSON_GetArraySize(areas); ++j)
+		{
+			cJSON* area(cJSON_GetArrayItem(areas, j));
+			cJSON* latitude(cJSON_GetObjectItem(area, "latitude"));
+			cJSON* longitude(cJSON_GetObjectItem(area, "longitude"));
+			cJSON* radius(cJSON_GetObjectItem(area, "radius"));
+			if (cJSON_IsNumber(latitude) && cJSON_IsNumber(longitude) && cJSON_IsNumber(radius) && radius->valuedouble > 0.0)
+				subscriber.areas.push_back(Area{ latitude->valuedouble, longitude->valuedouble, radius->valuedouble });
+		}
+
+		readStrings(item, "cities", subscriber.cities);
+		readStrings(item, "locations", subscriber.locations);
+		readStrings(item, "excludeCities", subscriber.excludeCities);
+		readStrings(item, "excludeLocations", subscriber.excludeLocations);
+		readStrings(item, "channels", subscriber.channels);
+		Add(std::move(subscriber));
+	}
+
+	cJSON_Delete(root);
+
+	if (skipped > 0)
+		Cerr << "Skipped " << skipped << " subscriptions without an id\n";
+	return true;
+}
+
+void SubscriptionEngine::Add(Subscriber subscriber)
+{
+	const auto toUpper([](std::vector<std::string>& values)
+	{
+		for (auto& v : values)
+			v = ToUpper(v);
+	});
+
+	toUpper(subscriber.cities);
+	toUpper(subscriber.locations);
+	toUpper(subscriber.excludeCities);
+	toUpper(subscriber.excludeLocations);
+
+	std::unique_lock<std::shared_mutex> lock(subscriberMutex);
+	size_t i;
+	const auto existing(subscriberIds.find(subscriber.id));
+	if (existing != subscriberIds.end())
+	{
+		i = existing->second;
+		Unindex(i);
+	}
+	else if (!freeSlots.empty())
+	{
+		i = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		i = subscribers.size();
+		subscribers.emplace_back();
+	}
+
+	subscriberIds[subscriber.id] = i;
+	subscribers[i] = std::move(subscriber);
+	Index(i);
+}
+
+bool SubscriptionEngine::Remove(const std::string& id)
+{
+	std::unique_lock<std::shared_mutex> lock(subscriberMutex);
+	const auto it(subscriberIds.find(id));
+	if (it == subscriberIds.end())
+		return false;
+
+	const size_t i(it->second);
+	Unindex(i);
+	subscribers[i] = Subscriber();
+	freeSlots.push_back(i);
+	subscriberIds.erase(it);
+	return true;
+}
+
+void SubscriptionEngine::Update(const Location& location, const bool& available)
+{
+	const std::string key(GetLocationKey(location.target, location.id));
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		const auto it(lastAvailable.find(key));
+		if (it == lastAvailable.end())
+		{
+			lastAvailable.emplace(key, available);
+			if (!available)
+				return;
+		}
+		else if (it->second == available)
+			return;
+		else
+			it->second = available;
+
+		++transitionCount;
+	}
+
+	if (!notifier)
+		return;
+
+	std::shared_lock<std::shared_mutex> lock(subscriberMutex);
+	for (const auto& i : Match(location))
+	{
+		notifier(subscribers[i], location, available);
+		++notificationCount;
+	}
+}
+
+// Only the subscribers filed under this location, its city and its cell are looked at
+std::vector<size_t> SubscriptionEngine::Match(const Location& location) const
+{
+	const std::string key(GetLocationKey(location.target, location.id));
+	const std::string city(ToUpper(location.city));
+
+	std::vector<size_t> matches;
+	const auto byLocation(locationIndex.find(key));
+	if (byLocation != locationIndex.end())
+		matches.insert(matches.end(), byLocation->second.begin(), byLocation->second.end());
+
+	if (!city.empty())
+	{
+		const auto byCity(cityIndex.find(city));
+		if (byCity != cityIndex.end())
+			matches.insert(matches.end(), byCity->second.begin(), byCity->second.end());
+	}
+
+	if (location.hasPosition)
+	{
+		const auto byCell(cellIndex.find(Geo::GetCellKey(Geo::GetCellIndex(location.latitude, cellSize), Geo::GetCellIndex(location.longitude, cellSize))));
+		if (byCell != cellIndex.end())
+		{
+			for (const auto& i : byCell->second)
+			{
+				if (IsInAreas(subscribers[i], location))
+					matches.push_back(i);
+			}
+		}
+	}
+
+	// Someone may match more than one way
+	std::sort(matches.begin(), matches.end());
+	matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+	matches.erase(std::remove_if(matches.begin(), matches.end(),
+		[this, &key, &city](const size_t& i) { return IsExcluded(subscribers[i], key, city); }), matches.end());
+
+	return matches;
+}
+
+bool SubscriptionEngine::IsExcluded(const Subscriber& subscriber, const std::string& locationKey, const std::string& city) const
+{
+	return std::find(subscriber.excludeLocations.begin(), subscriber.excludeLocations.end(), locationKey) != subscriber.excludeLocations.end() ||
+		(!city.empty() && std::find(subscriber.excludeCities.begin(), subscriber.excludeCities.end(), city) != subscriber.excludeCities.end());
+}
+
+bool SubscriptionEngine::IsInAreas(const Subscriber& subscriber, const Location& location) const
+{
+	for (const auto& area : subscriber.areas)
+	{
+		if (Geo::GetDistance(area.latitude, area.longitude, location.latitude, location.longitude) <= area.radius)
+			return true;
+	}
+
+	return false;
+}
+
+void SubscriptionEngine::Index(const size_t& i)
+{
+	const Subscriber& s(subscribers[i]);
+	for (const auto& l : s.locations)
+		locationIndex[l].push_back(i);
+	for (const auto& c : s.cities)
+		cityIndex[c].push_back(i);
+
+	// Overlapping areas share cells; file the subscriber under each cell once
+	std::vector<long long> cells;
+	for (const auto& a : s.areas)
+	{
+		const auto areaCells(GetCells(a));
+		cells.insert(cells.end(), areaCells.begin(), areaCells.end());
+	}
+
+	std::sort(cells.begin(), cells.end());
+	cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+	for (const auto& c : cells)
+		cellIndex[c].push_back(i);
+}
+
+void SubscriptionEngine::Unindex(const size_t& i)
+{
+	const auto remove([&i](auto& index, const auto& key)
+	{
+		const auto it(index.find(key));
+		if (it == index.end())
+			return;
+
+		it->second.erase(std::remove(it->second.begin(), it->second.end(), i), it->second.end());
+		if (it->second.empty())
+			index.erase(it);
+	});
+
+	const Subscriber& s(subscribers[i]);
+	for (const auto& l : s.locations)
+		remove(locationIndex, l);
+	for (const auto& c : s.cities)
+		remove(cityIndex, c);
+	for (const auto& a : s.areas)
+	{
+		for (const auto& c : GetCells(a))
+			remove(cellIndex, c);
+	}
+}
+
+// Cells touched by the area's bounding box
+std::vector<long long> SubscriptionEngine::GetCells(const Area& area)
+{
+	const double latitudeSpan(area.radius / Geo::milesPerDegree);
+	const double longitudeSpan(area.radius / Geo::GetMilesPerDegreeLongitude(area.latitude));
+
+	std::vector<long long> cells;
+	for (int r = Geo::GetCellIndex(area.latitude - latitudeSpan, cellSize); r <= Geo::GetCellIndex(area.latitude + latitudeSpan, cellSize); ++r)
+	{
+		for (int c = Geo::GetCellIndex(area.longitude - longitudeSpan, cellSize); c <= Geo::GetCellIndex(area.longitude + longitudeSpan, cellSize); ++c)
+			cells.push_back(Geo::GetCellKey(r, c));
+	}
+
+	return cells;
+}
+
+size_t SubscriptionEngine::GetSubscriberCount() const
+{
+	std::shared_lock<std::shared_mutex> lock(subscriberMutex);
+	return subscriberIds.size();
+}
+
+std::vector<std::string> SubscriptionEngine::GetChannels() const
+{
+	std::vector<std::string> channels;
+	std::shared_lock<std::shared_mutex> lock(subscriberMutex);
+	for (const auto& subscriber : subscribers)
+	{
+		for (const auto& c : subscriber.channels)
+		{
+			if (std::find(channels.begin(), channels.end(), c) == channels.end())
+				channels.push_back(c);
+		}
+	}
+
+	return channels;
+}
+
+std::string SubscriptionEngine::GetSummary() const
+{
+	std::ostringstream ss;
+	{
+		std::shared_lock<std::shared_mutex> lock(subscriberMutex);
+		ss << subscriberIds.size() << " subscribers (" << locationIndex.size() << " locations, " << cityIndex.size()
+			<< " cities, " << cellIndex.size() << " cells indexed)";
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(stateMutex);
+		ss << "; " << transitionCount << " availability changes";
+	}
+
+	ss << ", " << notificationCount << " notifications sent";
+	return ss.str();
+}
+
+std::string SubscriptionEngine::GetLocationKey(const std::string& target, const std::string& id)
+{
+	return ToUpper(target + ':' + id);
+}
+
+std::string SubscriptionEngine::ToUpper(const std::string& s)
+{
+	std::string upper(s);
+	std::transform(upper.begin(), upper.end(), upper.begin(), [](const unsigned char& c) { return static_cast<char>(std::toupper(c)); });
+	return upper;
+}
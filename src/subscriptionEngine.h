@@ -0,0 +1,110 @@
+// File:  subscriptionEngine.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Matches availability changes to subscribers, so one set of targets can serve any number
+//        of people with their own areas, cities, stores and exclusions.  Subscribers are indexed
+//        by location, by city and by the grid cells their areas cover; a change only looks at the
+//        subscribers filed under its own location, city and cell.  Polling doesn't depend on
+//        subscribers at all - every location is still checked once per period.
+
+#ifndef SUBSCRIPTION_ENGINE_H_
+#define SUBSCRIPTION_ENGINE_H_
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+
+class SubscriptionEngine
+{
+public:
+	struct Area
+	{
+		double latitude;// [deg]
+		double longitude;// [deg]
+		double radius;// [miles]
+	};
+
+	struct Subscriber
+	{
+		std::string id;
+		std::vector<Area> areas;
+		std::vector<std::string> cities;
+		std::vector<std::string> locations;// "<target>:<location id>", e.g. "Rite Aid:1234" or "Jefferson:registration"
+		std::vector<std::string> excludeCities;
+		std::vector<std::string> excludeLocations;
+		std::vector<std::string> channels;// Not interpreted here; passed along with each notification for whoever delivers it
+	};
+
+	// Something a target checks
+	struct Location
+	{
+		std::string target;
+		std::string id;// Unique within the target
+		std::string description;// For people
+		std::string city;
+		std::string state;
+
+		bool hasPosition = false;
+		double latitude = 0.0;// [deg]
+		double longitude = 0.0;// [deg]
+	};
+
+	// Called for each matching subscriber, on the thread that reported the change.  Must not add or remove subscribers.
+	typedef std::function<void(const Subscriber& subscriber, const Location& location, const bool& available)> Notifier;
+	void SetNotifier(Notifier n) { notifier = std::move(n); }// Call before any updates
+
+	// JSON array of subscriber objects with the same fields as Subscriber (areas as {latitude, longitude, radius});
+	// a missing file just means there are no subscribers
+	bool Load(const std::string& fileName);
+
+	// Thread-safe; replaces any subscriber with the same id
+	void Add(Subscriber subscriber);
+	bool Remove(const std::string& id);
+
+	// Thread-safe; notifies matching subscribers when the location's availability changes (a location seen for
+	// the first time only counts as a change if it's available)
+	void Update(const Location& location, const bool& available);
+
+	size_t GetSubscriberCount() const;
+	std::vector<std::string> GetChannels() const;// Every channel any subscriber names, once each
+	std::string GetSummary() const;
+
+private:
+	static const double cellSize;// [deg]
+
+	mutable std::shared_mutex subscriberMutex;
+	std::vector<Subscriber> subscribers;// Removed subscribers leave an empty id behind until the slot is reused
+	std::vector<size_t> freeSlots;
+	std::unordered_map<std::string, size_t> subscriberIds;
+
+	// Upper case, so different sources' capitalization doesn't matter
+	std::unordered_map<std::string, std::vector<size_t>> locationIndex;
+	std::unordered_map<std::string, std::vector<size_t>> cityIndex;
+	std::unordered_map<long long, std::vector<size_t>> cellIndex;// Every cell an area's bounding box touches
+
+	void Index(const size_t& i);
+	void Unindex(const size_t& i);
+	static std::vector<long long> GetCells(const Area& area);
+
+	// Indices into subscribers of everyone interested in the location; call with subscriberMutex held (shared is enough)
+	std::vector<size_t> Match(const Location& location) const;
+	bool IsExcluded(const Subscriber& subscriber, const std::string& locationKey, const std::string& city) const;
+	bool IsInAreas(const Subscriber& subscriber, const Location& location) const;
+
+	Notifier notifier;
+
+	mutable std::mutex stateMutex;
+	std::unordered_map<std::string, bool> lastAvailable;// By location key
+	unsigned long long transitionCount = 0;
+	std::atomic<unsigned long long> notificationCount = 0;
+
+	static std::string GetLocationKey(const std::string& target, const std::string& id);
+	static std::string ToUpper(const std::string& s);
+};
+
+#endif// SUBSCRIPTION_ENGINE_H_
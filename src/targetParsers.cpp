@@ -0,0 +1,282 @@
+// File:  targetParsers.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Response parsers for every target, kept out of the check code so they can be linked
+//        without wxWidgets or the network (see bench/parserBench.cpp).  Nothing here may depend
+//        on a MainFrame or on anything defined in the targets' other translation units.
+
+// Local headers
+#include "cvsTarget.h"
+#include "riteAidTarget.h"
+#include "jeffersonTarget.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+bool FinderTarget::ReadJSON(cJSON* root, const char* field, std::string& value)
+{
+	cJSON* element(cJSON_GetObjectItem(root, field));
+	if (!element || !cJSON_IsString(element))
+		return false;
+
+	value = element->valuestring;
+	return true;
+}
+
+bool FinderTarget::ReadJSON(cJSON* root, const char* field, unsigned int& value)
+{
+	cJSON* element(cJSON_GetObjectItem(root, field));
+	if (!element || !cJSON_IsNumber(element))
+		return false;
+
+	value = static_cast<unsigned int>(element->valueint);
+	return true;
+}
+
+bool FinderTarget::ReadJSON(cJSON* root, const char* field, bool& value)
+{
+	cJSON* element(cJSON_GetObjectItem(root, field));
+	if (!element || !cJSON_IsBool(element))
+		return false;
+
+	value = cJSON_IsTrue(element) != 0;
+	return true;
+}
+
+bool FinderTarget::ReadJSON(cJSON* root, const char* field, double& value)
+{
+	cJSON* element(cJSON_GetObjectItem(root, field));
+	if (!element || !cJSON_IsNumber(element))
+		return false;
+
+	value = element->valuedouble;
+	return true;
+}
+
+bool CVSTarget::ParseResponse(const std::string& response, const std::vector<std::string>& excludeLocations,
+	std::vector<std::string>& availableCities, std::vector<LocationAvailability>& locations,
+	unsigned int& recordCount, unsigned int& skippedCount)
+{
+	availableCities.clear();
+	locations.clear();
+	recordCount = 0;
+	skippedCount = 0;
+	cJSON* root(cJSON_Parse(response.c_str()));
+	if (!root)
+	{
+		Cerr << "Failed to parse root node\n";
+		return false;
+	}
+
+	cJSON* payload(cJSON_GetObjectItem(root, "responsePayloadData"));
+	if (!payload)
+	{
+		cJSON_Delete(root);
+		Cerr << "Failed to find payload node\n";
+		return false;
+	}
+
+	bool bookingComplete;
+	if (!ReadJSON(payload, "isBookingCompleted", bookingComplete))
+	{
+		cJSON_Delete(root);
+		Cerr << "Failed to read isBookingCompleted\n";
+		return false;
+	}
+
+	if (bookingComplete)
+	{
+		cJSON_Delete(root);
+		return true;
+	}
+
+	// To avoid missing potential locations, we'll exclude locations that we know are too far away, but include unknown locations
+	cJSON* data(cJSON_GetObjectItem(payload, "data"));
+	if (!data)
+	{
+		cJSON_Delete(root);
+		Cerr << "Failed to find data node\n";
+		return false;
+	}
+
+	cJSON* paLocations(cJSON_GetObjectItem(data, "PA"));
+	if (!paLocations)
+	{
+		cJSON_Delete(root);
+		Cerr << "Failed to find PA locations array\n";
+		return false;
+	}
+
+	recordCount = static_cast<unsigned int>(cJSON_GetArraySize(paLocations));
+	for (unsigned int i = 0; i < recordCount; ++i)
+	{
+		auto location(cJSON_GetArrayItem(paLocations, i));
+		std::string status, city;
+		if (!location || !ReadJSON(location, "status", status) || !ReadJSON(location, "city", city))
+		{
+			++skippedCount;
+			continue;
+		}
+
+		// If it wasn't fully booked, appointments are available; see if we want to exclude the location
+		locations.push_back(LocationAvailability{city, status != "Fully Booked"});
+		if (!locations.back().available)
+			continue;
+
+		if (std::find(excludeLocations.begin(), excludeLocations.end(), city) != excludeLocations.end())
+			continue;
+
+		availableCities.push_back(city);
+	}
+
+	// Once per response rather than once per location, so a changed schema doesn't flood the log
+	if (skippedCount > 0)
+		Cerr << "Skipped " << skippedCount << " of " << recordCount << " CVS locations with missing fields\n";
+
+	cJSON_Delete(root);
+	return true;
+}
+
+bool RiteAidTarget::ParseLocations(const std::string& response, std::vector<Location>& data, unsigned int& recordCount, unsigned int& skippedCount)
+{
+	recordCount = 0;
+	skippedCount = 0;
+	cJSON* root(cJSON_Parse(response.c_str()));
+	if (!root)
+	{
+		Cerr << "Failed to parse root node\n";
+		return false;
+	}
+
+	cJSON* dataObject(cJSON_GetObjectItem(root, "Data"));
+	if (!dataObject)
+	{
+		Cerr << "Failed to get data object\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	cJSON* storeArray(cJSON_GetObjectItem(dataObject, "stores"));
+	if (!storeArray)
+	{
+		Cerr << "Failed to get stores array\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	// A store that's missing something is skipped without losing the rest of the response
+	recordCount = static_cast<unsigned int>(cJSON_GetArraySize(storeArray));
+	for (unsigned int i = 0; i < recordCount; ++i)
+	{
+		cJSON* item(cJSON_GetArrayItem(storeArray, i));
+		Location loc;
+		if (!item ||
+			!ReadJSON(item, "storeNumber", loc.storeNumber) ||
+			!ReadJSON(item, "address", loc.address) ||
+			!ReadJSON(item, "city", loc.city) ||
+			!ReadJSON(item, "state", loc.state) ||
+			!ReadJSON(item, "zipcode", loc.zip))
+		{
+			++skippedCount;
+			continue;
+		}
+
+		// Position is only used to plan store-finder queries, so it's fine if it's missing
+		loc.hasPosition = ReadJSON(item, "latitude", loc.latitude) &&
+			ReadJSON(item, "longitude", loc.longitude) &&
+			ReadJSON(item, "milesFromCenter", loc.milesFromCenter);
+
+		loc.statusURL = GetStatusCheckURL(loc.storeNumber);
+		loc.description = GetDescription(loc);
+		data.push_back(loc);
+	}
+
+	if (skippedCount > 0)
+		Cerr << "Skipped " << skippedCount << " of " << recordCount << " Rite Aid stores with missing fields\n";
+
+	cJSON_Delete(root);
+	return true;
+}
+
+bool RiteAidTarget::IsInSearchArea(const Location& location, const bool& phillyMode)
+{
+	if (location.state != "PA")
+		return false;
+
+	return (phillyMode && location.city == "Philadelphia") ||
+		(!phillyMode && location.city != "Philadelphia");
+}
+
+bool RiteAidTarget::ParseStatus(const std::string& response, bool& available)
+{
+	cJSON* root(cJSON_Parse(response.c_str()));
+	if (!root)
+	{
+		Cerr << "Failed to parse root node\n";
+		return false;
+	}
+
+	cJSON* dataObject(cJSON_GetObjectItem(root, "Data"));
+	if (!dataObject)
+	{
+		Cerr << "Failed to get data object\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	cJSON* slots(cJSON_GetObjectItem(dataObject, "slots"));
+	if (!slots)
+	{
+		Cerr << "Failed to get slots object\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	// Not sure what the difference is between one and two?  First/second dose availability?
+	bool one, two;
+	if (!ReadJSON(slots, "1", one))
+	{
+		Cerr << "Failed to read one\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	if (!ReadJSON(slots, "2", two))
+	{
+		Cerr << "Failed to read two\n";
+		cJSON_Delete(root);
+		return false;
+	}
+
+	available = one || two;
+	/*if (available)// Until we understand one/two, provide additional diagnostics
+	// I still don't understand 100%, but I have not yet seen a response different from 1:true,2:false, so we'll ignore this for now 3/6/2021
+		Cout << "one:  " << static_cast<int>(one) << "; two:  " << static_cast<int>(two) << std::endl;*/
+
+	return true;
+}
+
+std::string RiteAidTarget::GetStatusCheckURL(const unsigned int& storeNumber)
+{
+	return "https://www.riteaid.com/services/ext/v2/vaccine/checkSlots?storeNumber=" + std::to_string(storeNumber);
+}
+
+std::string RiteAidTarget::GetDescription(const Location& location)
+{
+	return "Rite Aid Location Info:  " + location.address + ", " + location.city + ", " + location.state + " " + location.zip + '\n';
+}
+
+bool JeffersonTarget::DoesNotHaveThreeRegistrationFullStatements(const std::string& html)
+{
+	// Pages are large; stop scanning as soon as the answer is known
+	const std::string testString("Registration is currently full at this location.");
+	std::string::size_type position(html.find(testString));
+	unsigned int count(0);
+	while (position != std::string::npos && count < 3)
+	{
+		++count;
+		position = html.find(testString, position + testString.length());
+	}
+
+	return count < 3;
+}
@@ -0,0 +1,118 @@
+// File:  targetWatchdog.cpp
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Watches target heartbeats for checks that have hung or fallen behind schedule, and for
+//        check durations that break their service-level objective.  Decides what to report and
+//        which targets to restart; the caller does the restarting.
+
+// Local headers
+#include "targetWatchdog.h"
+
+// Standard C++ headers
+#include <algorithm>
+
+const std::chrono::steady_clock::duration TargetWatchdog::checkDurationObjective(std::chrono::seconds(60));
+const std::chrono::steady_clock::duration TargetWatchdog::hungCheckDuration(std::chrono::seconds(180));
+const double TargetWatchdog::behindSchedulePeriods(0.5);
+const double TargetWatchdog::wedgedPeriods(2.0);
+
+TargetWatchdog::Verdict TargetWatchdog::Evaluate(const FinderTarget& target)
+{
+	Verdict verdict;
+	const std::string& name(target.GetName());
+	auto& state(targets[name]);
+	state.health = target.GetHealth();
+	const auto& health(state.health);
+
+	// Transfers are abandoned at the deadline, so a check should finish soon after; report it once if it doesn't
+	if (health.checking && health.checkElapsed > FinderTarget::maxCheckDuration && state.overrunFlagged != health.checkCount + 1)
+	{
+		verdict.alerts.push_back(name + " check has run for " + ToSeconds(health.checkElapsed) + " sec, past its "
+			+ ToSeconds(FinderTarget::maxCheckDuration) + " sec deadline");
+		state.overrunFlagged = health.checkCount + 1;
+	}
+
+	const auto period(target.GetCheckPeriod());
+	const double lagPeriods(std::chrono::duration<double>(health.scheduleLag) / period);
+	if (lagPeriods > behindSchedulePeriods && !state.behindSchedule)
+	{
+		verdict.alerts.push_back(name + " is " + ToSeconds(health.scheduleLag) + " sec behind schedule");
+		state.behindSchedule = true;
+	}
+	else if (lagPeriods <= behindSchedulePeriods && state.behindSchedule)
+	{
+		verdict.alerts.push_back(name + " is back on schedule");
+		state.behindSchedule = false;
+	}
+
+	if (health.p99CheckDuration > checkDurationObjective && !state.objectiveBreached)
+	{
+		verdict.alerts.push_back(name + " check p99 (" + ToSeconds(health.p99CheckDuration) + " sec) exceeded the "
+			+ ToSeconds(checkDurationObjective) + " sec objective");
+		state.objectiveBreached = true;
+	}
+	else if (health.checkCount > 0 && health.p99CheckDuration <= checkDurationObjective && state.objectiveBreached)
+	{
+		verdict.alerts.push_back(name + " check p99 is back within the " + ToSeconds(checkDurationObjective) + " sec objective");
+		state.objectiveBreached = false;
+	}
+
+	// Give a restarted target time to show whether the restart helped before trying again
+	const bool hung(health.checking && health.checkElapsed > hungCheckDuration);
+	const bool wedged(lagPeriods > wedgedPeriods);
+	const auto now(std::chrono::steady_clock::now());
+	const auto restartInterval(std::max(hungCheckDuration,
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * wedgedPeriods)));
+	if ((hung || wedged) && (state.restartCount == 0 || now - state.lastRestart > restartInterval))
+	{
+		if (hung)
+			verdict.alerts.push_back(name + " check has been stuck for " + ToSeconds(health.checkElapsed) + " sec; restarting");
+		else
+			verdict.alerts.push_back(name + " has missed its checks for " + ToSeconds(health.scheduleLag) + " sec; restarting");
+
+		verdict.restart = true;
+		++state.restartCount;
+		state.lastRestart = now;
+		state.overrunFlagged = 0;
+		state.behindSchedule = false;
+	}
+
+	return verdict;
+}
+
+std::string TargetWatchdog::GetStatus() const
+{
+	cJSON* root(cJSON_CreateObject());
+	cJSON_AddStringToObject(root, "name", "watchdog");
+	cJSON_AddNumberToObject(root, "checkDurationObjective", std::chrono::duration<double>(checkDurationObjective).count());
+
+	cJSON* array(cJSON_AddArrayToObject(root, "targets"));
+	for (const auto& t : targets)
+	{
+		cJSON* target(cJSON_CreateObject());
+		cJSON_AddStringToObject(target, "name", t.first.c_str());
+		cJSON_AddBoolToObject(target, "checking", t.second.health.checking);
+		cJSON_AddNumberToObject(target, "checkElapsed", std::chrono::duration<double>(t.second.health.checkElapsed).count());
+		cJSON_AddNumberToObject(target, "scheduleLag", std::chrono::duration<double>(t.second.health.scheduleLag).count());
+		cJSON_AddNumberToObject(target, "p99CheckDuration", std::chrono::duration<double>(t.second.health.p99CheckDuration).count());
+		cJSON_AddBoolToObject(target, "behindSchedule", t.second.behindSchedule);
+		cJSON_AddBoolToObject(target, "objectiveBreached", t.second.objectiveBreached);
+		cJSON_AddNumberToObject(target, "restarts", t.second.restartCount);
+		cJSON_AddItemToArray(array, target);
+	}
+
+	std::string json;
+	if (char* printed = cJSON_PrintUnformatted(root))
+	{
+		json = printed;
+		cJSON_free(printed);
+	}
+
+	cJSON_Delete(root);
+	return json;
+}
+
+std::string TargetWatchdog::ToSeconds(const std::chrono::duration<double>& d)
+{
+	return std::to_string(static_cast<long long>(d.count()));
+}
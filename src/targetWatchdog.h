@@ -0,0 +1,60 @@
+// File:  targetWatchdog.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Watches target heartbeats for checks that have hung or fallen behind schedule, and for
+//        check durations that break their service-level objective.  Decides what to report and
+//        which targets to restart; the caller does the restarting.
+
+#ifndef TARGET_WATCHDOG_H_
+#define TARGET_WATCHDOG_H_
+
+// Local headers
+#include "finderTarget.h"
+
+// Standard C++ headers
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+class TargetWatchdog
+{
+public:
+	struct Verdict
+	{
+		bool restart = false;
+		std::vector<std::string> alerts;// For the log and event stream
+	};
+
+	// Call periodically for each running target
+	Verdict Evaluate(const FinderTarget& target);
+
+	// Forget everything (targets have been replaced)
+	void Reset() { targets.clear(); }
+
+	// JSON object for the status API
+	std::string GetStatus() const;
+
+	static const std::chrono::steady_clock::duration checkDurationObjective;// p99
+
+private:
+	static const std::chrono::steady_clock::duration hungCheckDuration;// Well past FinderTarget::maxCheckDuration, when transfers are abandoned
+	static const double behindSchedulePeriods;// Lag (in check periods) worth reporting
+	static const double wedgedPeriods;// Lag (in check periods) at which the target is restarted
+
+	struct TargetState
+	{
+		FinderTarget::Health health;
+		unsigned long long overrunFlagged = 0;// One more than the check count when an overrun was last reported
+		bool behindSchedule = false;
+		bool objectiveBreached = false;
+		unsigned int restartCount = 0;
+		std::chrono::steady_clock::time_point lastRestart;
+	};
+
+	std::map<std::string, TargetState> targets;
+
+	static std::string ToSeconds(const std::chrono::duration<double>& d);
+};
+
+#endif// TARGET_WATCHDOG_H_
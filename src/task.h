@@ -0,0 +1,242 @@
+// File:  task.h
+// Date:  10/19/2026
+// Auth:  K. Loux
+// Desc:  Minimal C++20 coroutine task, used to write checks as chains of requests.  A Task does
+//        not start until it is awaited (or passed to SyncWait or ResumeQueue::Run).  Operations
+//        that finish on another thread post their continuations to a ResumeQueue, so the task
+//        resumes on the thread that's running it rather than holding up the other one.
+
+#ifndef TASK_H_
+#define TASK_H_
+
+// Standard C++ headers
+#include <coroutine>
+#include <optional>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <utility>
+
+template<typename T>
+class Task
+{
+public:
+	struct promise_type
+	{
+		std::optional<T> value;
+		std::coroutine_handle<> continuation;
+
+		Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+		std::suspend_always initial_suspend() noexcept { return {}; }
+
+		struct FinalAwaiter
+		{
+			bool await_ready() noexcept { return false; }
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+			{
+				if (h.promise().continuation)
+					return h.promise().continuation;
+				return std::noop_coroutine();
+			}
+			void await_resume() noexcept {}
+		};
+
+		FinalAwaiter final_suspend() noexcept { return {}; }
+		void return_value(T v) { value = std::move(v); }
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	Task(Task&& t) noexcept : coroutine(std::exchange(t.coroutine, nullptr)) {}
+	Task& operator=(Task&& t) noexcept
+	{
+		if (this != &t)
+		{
+			if (coroutine)
+				coroutine.destroy();
+			coroutine = std::exchange(t.coroutine, nullptr);
+		}
+		return *this;
+	}
+
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	~Task()
+	{
+		if (coroutine)
+			coroutine.destroy();
+	}
+
+	// Awaiting a task starts it and resumes the awaiting coroutine once it has finished
+	bool await_ready() const noexcept { return false; }
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+	{
+		coroutine.promise().continuation = awaiting;
+		return coroutine;
+	}
+	T await_resume() { return std::move(*coroutine.promise().value); }
+
+private:
+	explicit Task(std::coroutine_handle<promise_type> coroutine) : coroutine(coroutine) {}
+	std::coroutine_handle<promise_type> coroutine;
+};
+
+namespace TaskInternal
+{
+
+// Coroutine that starts immediately and cleans itself up when done
+struct DetachedTask
+{
+	struct promise_type
+	{
+		DetachedTask get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+struct Latch
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool done = false;
+
+	void Set()
+	{
+		// Notify while holding the lock; the waiter may destroy the latch as soon as it sees done
+		std::lock_guard<std::mutex> lock(mutex);
+		done = true;
+		condition.notify_all();
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return done; });
+	}
+};
+
+template<typename T>
+DetachedTask AwaitAndSignal(Task<T>& task, std::optional<T>& result, Latch& latch)
+{
+	result = co_await task;
+	latch.Set();
+}
+
+// The task only resumes on the thread running it, so that's the only thread that touches done
+template<typename T>
+DetachedTask AwaitAndFlag(Task<T>& task, std::optional<T>& result, bool& done)
+{
+	result = co_await task;
+	done = true;
+}
+
+struct WhenAllState
+{
+	std::atomic<size_t> remaining;
+	std::coroutine_handle<> continuation;
+};
+
+template<typename T>
+DetachedTask AwaitAndCount(Task<T>& task, std::optional<T>& result, WhenAllState& state)
+{
+	result = co_await task;
+	if (state.remaining.fetch_sub(1) == 1)
+		state.continuation.resume();
+}
+
+template<typename T>
+struct WhenAllAwaiter
+{
+	std::vector<Task<T>>& tasks;
+	std::vector<std::optional<T>>& results;
+	WhenAllState& state;
+
+	bool await_ready() const noexcept { return tasks.empty(); }
+	bool await_suspend(std::coroutine_handle<> awaiting)
+	{
+		// One extra count so nothing resumes us until every task has been started
+		state.continuation = awaiting;
+		state.remaining = tasks.size() + 1;
+		for (size_t i = 0; i < tasks.size(); ++i)
+			AwaitAndCount(tasks[i], results[i], state);
+		return state.remaining.fetch_sub(1) != 1;
+	}
+	void await_resume() noexcept {}
+};
+
+}// namespace TaskInternal
+
+// Blocks the calling thread until the task completes
+template<typename T>
+T SyncWait(Task<T> task)
+{
+	std::optional<T> result;
+	TaskInternal::Latch latch;
+	TaskInternal::AwaitAndSignal(task, result, latch);
+	latch.Wait();
+	return std::move(*result);
+}
+
+// Runs a task on one thread even though what it awaits completes on others:  awaiters post their
+// continuations here instead of resuming them, and Run() resumes them on its own thread
+class ResumeQueue
+{
+public:
+	// Thread-safe; once this is called, the caller must not touch anything the coroutine might destroy
+	void Post(std::coroutine_handle<> coroutine)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.push_back(coroutine);
+		condition.notify_one();
+	}
+
+	// Blocks the calling thread until the task completes, resuming posted coroutines on it in the meantime.
+	// Only one thread may run tasks from a given queue.
+	template<typename T>
+	T Run(Task<T> task)
+	{
+		std::optional<T> result;
+		bool done(false);
+		TaskInternal::AwaitAndFlag(task, result, done);
+		while (!done)
+			WaitForNext().resume();
+		return std::move(*result);
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::coroutine_handle<>> ready;
+
+	std::coroutine_handle<> WaitForNext()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return !ready.empty(); });
+		const auto coroutine(ready.front());
+		ready.pop_front();
+		return coroutine;
+	}
+};
+
+// Runs all tasks concurrently; results are in the same order as the tasks
+template<typename T>
+Task<std::vector<T>> WhenAll(std::vector<Task<T>> tasks)
+{
+	std::vector<std::optional<T>> results(tasks.size());
+	TaskInternal::WhenAllState state;
+	co_await TaskInternal::WhenAllAwaiter<T>{ tasks, results, state };
+
+	std::vector<T> values;
+	values.reserve(results.size());
+	for (auto& r : results)
+		values.push_back(std::move(*r));
+	co_return values;
+}
+
+#endif// TASK_H_
@@ -21,5 +21,9 @@ bool VaccineFinderApp::OnInit()
 
 	mainFrame->Show(true);
 
+	// Replay a recorded timeline against each check timing policy; results are shown in the history
+	if (argc == 3 && argv[1] == _T("--simulate"))
+		mainFrame->RunSimulation(argv[2].ToStdString());
+
 	return true;
 }